@@ -0,0 +1,126 @@
+/*
+ * ctester -- allocation tracking
+ *
+ * Link this file into a test binary to count the heap allocations of each
+ * test. It replaces malloc(3) and friends by wrappers around the glibc
+ * allocator, which update ::ctester_alloc_stats. The runner resets the
+ * statistics before each test and reports them afterwards, and the
+ * ::ASSERT_MAX_ALLOCS and ::ASSERT_NO_LEAKS assertions are built on them.
+ * Allocations the runner or glibc make on behalf of a test are not counted,
+ * see ::_ctester_alloc_untracked.
+ */
+
+#define _GNU_SOURCE
+#include "ctester.h"
+
+#include <dlfcn.h>
+#include <malloc.h>
+#include <pthread.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *pointer);
+
+struct ctester_alloc_stats_t ctester_alloc_stats;
+
+/**
+ * Account for a new block of memory.
+ */
+static void track_allocation(void *pointer) {
+	if(!pointer || _ctester_alloc_untracked) {
+		return;
+	}
+	long long size = malloc_usable_size(pointer);
+	__atomic_add_fetch(&ctester_alloc_stats.allocations, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&ctester_alloc_stats.bytes, size, __ATOMIC_RELAXED);
+	long long live_bytes = __atomic_add_fetch(&ctester_alloc_stats.live_bytes, size, __ATOMIC_RELAXED);
+	long long peak_live_bytes = __atomic_load_n(&ctester_alloc_stats.peak_live_bytes, __ATOMIC_RELAXED);
+	while(live_bytes > peak_live_bytes && !__atomic_compare_exchange_n(&ctester_alloc_stats.peak_live_bytes, &peak_live_bytes, live_bytes, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/**
+ * Account for a block of memory of `size` usable bytes being released.
+ */
+static void track_free(size_t size) {
+	if(_ctester_alloc_untracked) {
+		return;
+	}
+	__atomic_add_fetch(&ctester_alloc_stats.frees, 1, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&ctester_alloc_stats.live_bytes, (long long)size, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size) {
+	void *pointer = __libc_malloc(size);
+	track_allocation(pointer);
+	return pointer;
+}
+
+void *calloc(size_t count, size_t size) {
+	void *pointer = __libc_calloc(count, size);
+	track_allocation(pointer);
+	return pointer;
+}
+
+void *realloc(void *pointer, size_t size) {
+	size_t old_size = pointer ? malloc_usable_size(pointer) : 0;
+	void *new_pointer = __libc_realloc(pointer, size);
+	// Resizing a block counts as releasing it and allocating a new one. On
+	// failure, the old block stays valid.
+	if(new_pointer || !size) {
+		if(pointer) {
+			track_free(old_size);
+		}
+		track_allocation(new_pointer);
+	}
+	return new_pointer;
+}
+
+void *memalign(size_t alignment, size_t size) {
+	void *pointer = __libc_memalign(alignment, size);
+	track_allocation(pointer);
+	return pointer;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+	return memalign(alignment, size);
+}
+
+int posix_memalign(void **pointer, size_t alignment, size_t size) {
+	if(alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+		return EINVAL;
+	}
+	void *new_pointer = memalign(alignment, size);
+	if(!new_pointer && size) {
+		return ENOMEM;
+	}
+	*pointer = new_pointer;
+	return 0;
+}
+
+void free(void *pointer) {
+	if(pointer) {
+		track_free(malloc_usable_size(pointer));
+	}
+	__libc_free(pointer);
+}
+
+/**
+ * Start a thread without counting the thread-local storage glibc allocates
+ * for it. glibc keeps it along with the stack of the thread for reuse once the
+ * thread exits, so every test starting threads would appear to leak it.
+ */
+int pthread_create(pthread_t *thread, const pthread_attr_t *attributes, void *(*start)(void *), void *argument) {
+	static int (*libc_pthread_create)(pthread_t *, const pthread_attr_t *, void *(*)(void *), void *);
+	int untracked = _ctester_alloc_untracked;
+	_ctester_alloc_untracked = 1;
+	int (*create)(pthread_t *, const pthread_attr_t *, void *(*)(void *), void *) = __atomic_load_n(&libc_pthread_create, __ATOMIC_RELAXED);
+	if(!create) {
+		create = dlsym(RTLD_NEXT, "pthread_create");
+		__atomic_store_n(&libc_pthread_create, create, __ATOMIC_RELAXED);
+	}
+	int error = create(thread, attributes, start, argument);
+	_ctester_alloc_untracked = untracked;
+	return error;
+}
@@ -0,0 +1,27 @@
+/*
+ * ctester -- shared objects of tests
+ *
+ * Link this file, instead of ctester.c, into a shared object of tests to run
+ * it with `ctester-run`, which loads any number of them into one process:
+ *
+ *    cc -shared -o foo-test.so foo-test.o ctester-module.o
+ *    ./ctester-run foo-test.so bar-test.so
+ *
+ * It exports the bounds of the object's registration sections as
+ * ::ctester_module. The functions the tests call are resolved against the
+ * runner, which must be linked with `-rdynamic`.
+ */
+
+#include "ctester.h"
+
+extern struct ctester_test_case_list_t *__start_ctester_tests[] __attribute__((weak, visibility("hidden")));
+extern struct ctester_test_case_list_t *__stop_ctester_tests[] __attribute__((weak, visibility("hidden")));
+extern const struct ctester_instantiation_t *__start_ctester_instantiations[] __attribute__((weak, visibility("hidden")));
+extern const struct ctester_instantiation_t *__stop_ctester_instantiations[] __attribute__((weak, visibility("hidden")));
+
+const struct ctester_module_t ctester_module = {
+	.tests_start = __start_ctester_tests,
+	.tests_stop = __stop_ctester_tests,
+	.instantiations_start = __start_ctester_instantiations,
+	.instantiations_stop = __stop_ctester_instantiations,
+};
@@ -1,5 +1,8 @@
 #include "ctester.h"
 
+#include <limits.h>
+#include <pthread.h>
+
 /**
  * \defgroup example Example use of ctester
  * @{
@@ -32,7 +35,40 @@ TEST(FactorialTest, Positive) {
 }
 
 TEST(FactorialTest, FlawedTest) {
-	EXPECT_EQ(0, Factorial(1), "This test will fail! Since we do not have stream i/o in C, this uses printf syntax. E.g.: %d", 0); // EXPECT_FAILURE
+	EXPECT_EQ(0, Factorial(1), "This test will fail! Since we do not have stream i/o in C, this uses printf syntax. E.g.: %d", 0);
+}
+
+BENCHMARK(FactorialTest, Ten) {
+	CTESTER_DO_NOT_OPTIMIZE(Factorial(10));
+}
+
+BENCHMARK(FactorialTest, Hundred) {
+	int n = 100;
+	__asm__ volatile("" : "+r"(n));
+	CTESTER_DO_NOT_OPTIMIZE(Factorial(n));
+}
+
+// The difference between these two is the cost of an assertion that passes.
+// `make bench` runs them along with printing the size of the test binary.
+int assertion_values[1024];
+
+BENCHMARK(AssertionOverhead, Baseline) {
+	for(int i = 0; i < 1024; i++) {
+		CTESTER_DO_NOT_OPTIMIZE(assertion_values[i]);
+	}
+}
+
+BENCHMARK(AssertionOverhead, ExpectGe) {
+	for(int i = 0; i < 1024; i++) {
+		CTESTER_DO_NOT_OPTIMIZE(assertion_values[i]);
+		EXPECT_GE(assertion_values[i], 0);
+	}
+}
+
+int assertion_copies[1024];
+
+BENCHMARK(AssertionOverhead, ArrayEq) {
+	EXPECT_ARRAY_EQ(assertion_values, assertion_copies, 1024);
 }
 
 /// @}
@@ -43,8 +79,8 @@ TEST(FactorialTest, FlawedTest) {
  * \defgroup ctester_self_test Self test & advanced features
  * @{
  *
- * The EXPECT_FAILURE comments used here are evaluated in the self-check
- * included in the Makefile.
+ * Assertions that are supposed to fail are wrapped in meta-assertions, such
+ * that the self-test passes without any failure.
  */
 
 TEST(AssertionMacros, Eq) {
@@ -53,14 +89,14 @@ TEST(AssertionMacros, Eq) {
 	ASSERT_EQ(-1, -1);
 	ASSERT_EQ(1.5f, 1.5f);
 
-	EXPECT_EQ(1, 2); // EXPECT_FAILURE
-	EXPECT_EQ(1.5, 2.5); // EXPECT_FAILURE
-	EXPECT_EQ(-1, -2); // EXPECT_FAILURE
-	EXPECT_EQ(1.5f, 2.5f); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_EQ(1, 2), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_EQ(1.5, 2.5), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_EQ(-1, -2), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_EQ(1.5f, 2.5f), 1);
 }
 
 TEST(AssertionMacros, DISABLED_EqFail) {
-	ASSERT_EQ(1, 2); // EXPECT_FAILURE
+	ASSERT_EQ(1, 2);
 }
 
 TEST(AssertionMacros, Ne) {
@@ -69,10 +105,10 @@ TEST(AssertionMacros, Ne) {
 	ASSERT_NE(-1, -2);
 	ASSERT_NE(1.5f, 2.5f);
 
-	EXPECT_NE(1, 1); // EXPECT_FAILURE
-	EXPECT_NE(1.5, 1.5); // EXPECT_FAILURE
-	EXPECT_NE(-1, -1); // EXPECT_FAILURE
-	EXPECT_NE(1.5f, 1.5f); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_NE(1, 1), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_NE(1.5, 1.5), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_NE(-1, -1), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_NE(1.5f, 1.5f), 1);
 }
 
 TEST(AssertionMacros, Gt) {
@@ -81,11 +117,11 @@ TEST(AssertionMacros, Gt) {
 	ASSERT_GT(-1, -2);
 	ASSERT_GT(1.5f, 1.0f);
 
-	EXPECT_GT(1, 1); // EXPECT_FAILURE
-	EXPECT_GT(1, 2); // EXPECT_FAILURE
-	EXPECT_GT(1.5, 2.0); // EXPECT_FAILURE
-	EXPECT_GT(-1, 1); // EXPECT_FAILURE
-	EXPECT_GT(1.5f, 2.0f); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_GT(1, 1), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_GT(1, 2), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_GT(1.5, 2.0), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_GT(-1, 1), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_GT(1.5f, 2.0f), 1);
 }
 
 TEST(AssertionMacros, Lt) {
@@ -94,11 +130,11 @@ TEST(AssertionMacros, Lt) {
 	ASSERT_LT(-2, -1);
 	ASSERT_LT(1.0f, 1.5f);
 
-	EXPECT_LT(2, 2); // EXPECT_FAILURE
-	EXPECT_LT(2, 1); // EXPECT_FAILURE
-	EXPECT_LT(2.0, 1.5); // EXPECT_FAILURE
-	EXPECT_LT(1, -1); // EXPECT_FAILURE
-	EXPECT_LT(2.0f, 1.5f); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_LT(2, 2), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_LT(2, 1), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_LT(2.0, 1.5), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_LT(1, -1), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_LT(2.0f, 1.5f), 1);
 }
 
 TEST(AssertionMacros, Le) {
@@ -107,10 +143,10 @@ TEST(AssertionMacros, Le) {
 	ASSERT_LE(-2, -1);
 	ASSERT_LE(1.0f, 1.5f);
 
-	EXPECT_LE(2, 1); // EXPECT_FAILURE
-	EXPECT_LE(2.0, 1.5); // EXPECT_FAILURE
-	EXPECT_LE(1, -1); // EXPECT_FAILURE
-	EXPECT_LE(2.0f, 1.5f); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_LE(2, 1), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_LE(2.0, 1.5), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_LE(1, -1), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_LE(2.0f, 1.5f), 1);
 }
 
 TEST(AssertionMacros, Ge) {
@@ -123,55 +159,55 @@ TEST(AssertionMacros, Ge) {
 	ASSERT_GE(1.5f, 1.0f);
 	ASSERT_GE(1.5f, 1.5f);
 
-	EXPECT_GE(1, 2); // EXPECT_FAILURE
-	EXPECT_GE(1.5, 2.0); // EXPECT_FAILURE
-	EXPECT_GE(-1, 1); // EXPECT_FAILURE
-	EXPECT_GE(1.5f, 2.0f); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_GE(1, 2), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_GE(1.5, 2.0), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_GE(-1, 1), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_GE(1.5f, 2.0f), 1);
 }
 
 TEST(AssertionMacros, True) {
 	ASSERT_TRUE(1 == 1);
-	EXPECT_TRUE(1 == 2); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_TRUE(1 == 2), 1);
 }
 
 TEST(AssertionMacros, FloatEq) {
 	ASSERT_FLOAT_EQ(1.f, 1.f + FLT_EPSILON);
-	EXPECT_FLOAT_EQ(1.f, 1.f + 100 * FLT_EPSILON); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_FLOAT_EQ(1.f, 1.f + 100 * FLT_EPSILON), 1);
 }
 
 TEST(AssertionMacros, FloatNe) {
 	ASSERT_FLOAT_NE(1.f, 1.f + 100 * FLT_EPSILON);
-	EXPECT_FLOAT_NE(1.f, 1.f + FLT_EPSILON); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_FLOAT_NE(1.f, 1.f + FLT_EPSILON), 1);
 }
 
 TEST(AssertionMacros, DoubleEq) {
 	ASSERT_DOUBLE_EQ(1., 1. + DBL_EPSILON);
-	EXPECT_DOUBLE_EQ(1., 1. + 100 * DBL_EPSILON); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_DOUBLE_EQ(1., 1. + 100 * DBL_EPSILON), 1);
 }
 
 TEST(AssertionMacros, DoubleNe) {
 	ASSERT_DOUBLE_NE(1., 1. + 100 * DBL_EPSILON);
-	EXPECT_DOUBLE_NE(1., 1. + DBL_EPSILON); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_DOUBLE_NE(1., 1. + DBL_EPSILON), 1);
 }
 
 TEST(AssertionMacros, StrEq) {
 	ASSERT_STREQ("foo", "foo");
-	EXPECT_STREQ("foo", "bar"); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_STREQ("foo", "bar"), 1);
 }
 
 TEST(AssertionMacros, StrNe) {
 	ASSERT_STRNE("foo", "bar");
-	EXPECT_STRNE("foo", "foo"); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_STRNE("foo", "foo"), 1);
 }
 
 TEST(AssertionMacros, StrCaseEq) {
 	ASSERT_STRCASEEQ("Foo", "foo");
-	EXPECT_STRCASEEQ("Foo", "bar"); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_STRCASEEQ("Foo", "bar"), 1);
 }
 
 TEST(AssertionMacros, StrCaseNe) {
 	ASSERT_STRCASENE("Foo", "bar");
-	EXPECT_STRCASENE("Foo", "foo"); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_STRCASENE("Foo", "foo"), 1);
 }
 
 void crashes_me() {
@@ -189,17 +225,484 @@ void does_nothing() {
 
 TEST(AssertionMacros, AssertDeath) {
 	ASSERT_DEATH(crashes_me());
-	EXPECT_DEATH(does_not_crash_me()); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_DEATH(does_not_crash_me()), 1);
+}
+
+void crashes_with_message() {
+	fprintf(stderr, "invalid state %d\n", 42);
+	abort();
+}
+
+void exits_with_message() {
+	fprintf(stderr, "goodbye\n");
+	exit(3);
+}
+
+TEST(AssertionMacros, AssertDeathMatchesOutput) {
+	ASSERT_DEATH(crashes_with_message(), "invalid state [0-9]+");
+	EXPECT_NONFATAL_FAILURE(EXPECT_DEATH(crashes_with_message(), "^valid state"), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_DEATH(crashes_with_message(), "^valid state", "Custom message %d", 1), 1);
+	ASSERT_EXIT(exits_with_message(), 3, "good");
+	EXPECT_NONFATAL_FAILURE(EXPECT_EXIT(exits_with_message(), 3, "^hello"), 1);
 }
 
 TEST(AssertionMacros, AssertExit) {
 	ASSERT_EXIT(does_not_crash_me(), 0);
-	EXPECT_EXIT(crashes_me(), 0); // EXPECT_FAILURE
-	EXPECT_EXIT(does_nothing(), 0); // EXPECT_FAILURE
+	EXPECT_NONFATAL_FAILURE(EXPECT_EXIT(crashes_me(), 0), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_EXIT(does_nothing(), 0), 1);
 }
 
 TEST(TestFlow, AddFailure) {
 	ADD_FAILURE();
 }
 
+void expect_positive(struct ctester_test_case_state_t *ctester_state, int value) {
+	EXPECT_GT(value, 0);
+}
+
+void assert_positive(struct ctester_test_case_state_t *ctester_state, int value) {
+	ASSERT_GT(value, 0);
+}
+
+TEST(MetaAssertions, CountNonfatalFailures) {
+	EXPECT_NONFATAL_FAILURE(expect_positive(ctester_state, 1), 0);
+	EXPECT_NONFATAL_FAILURE(expect_positive(ctester_state, -1); expect_positive(ctester_state, -2), 2);
+	EXPECT_NONFATAL_FAILURE(ADD_FAILURE(), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_NONFATAL_FAILURE(EXPECT_EQ(1, 2), 2), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_NONFATAL_FAILURE(ASSERT_EQ(1, 2), 1), 1);
+}
+
+TEST(MetaAssertions, FatalFailureEndsStatement) {
+	volatile int reached = 0;
+	EXPECT_FATAL_FAILURE(assert_positive(ctester_state, -1); reached = 1);
+	EXPECT_EQ(reached, 0);
+	EXPECT_FATAL_FAILURE(ASSERT_EQ(1, 2));
+	EXPECT_FATAL_FAILURE(FAIL("Custom message"));
+	EXPECT_NONFATAL_FAILURE(EXPECT_FATAL_FAILURE(assert_positive(ctester_state, 1)), 1);
+}
+
+TEST(BulkAssertions, EveryMismatchIsFound) {
+	// Odd sizes exercise the scalar tails of the vector kernels
+	enum { SIZE = 1003 };
+	int *a = malloc(SIZE * sizeof(int));
+	int *b = malloc(SIZE * sizeof(int));
+	for(int i = 0; i < SIZE; i++) {
+		a[i] = b[i] = i * 7;
+	}
+	EXPECT_ARRAY_EQ(a, b, SIZE);
+	EXPECT_MEMEQ(a, b, SIZE * sizeof(int));
+	for(int i = 0; i < SIZE; i++) {
+		b[i]++;
+		EXPECT_NONFATAL_FAILURE(EXPECT_ARRAY_EQ(a, b, SIZE), 1);
+		EXPECT_NONFATAL_FAILURE(EXPECT_MEMEQ(a, b, SIZE * sizeof(int)), 1);
+		EXPECT_ARRAY_EQ(a, b, i);
+		b[i]--;
+	}
+	EXPECT_FATAL_FAILURE(ASSERT_ARRAY_EQ(a, b + 1, 1));
+	free(a);
+	free(b);
+}
+
+TEST(BulkAssertions, NearWithinTolerance) {
+	enum { SIZE = 101 };
+	float a[SIZE], b[SIZE];
+	double c[SIZE], d[SIZE];
+	for(int i = 0; i < SIZE; i++) {
+		a[i] = c[i] = i;
+		b[i] = d[i] = i + .25;
+	}
+	EXPECT_ARRAY_NEAR(a, b, SIZE, .25);
+	EXPECT_ARRAY_NEAR(c, d, SIZE, .25);
+	EXPECT_NONFATAL_FAILURE(EXPECT_ARRAY_NEAR(a, b, SIZE, .125), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_ARRAY_NEAR(c, d, SIZE, .125), 1);
+	a[50] = b[50] = c[50] = d[50] = NAN;
+	EXPECT_ARRAY_NEAR(a, b, SIZE, .25);
+	EXPECT_ARRAY_NEAR(c, d, SIZE, .25);
+	b[50] = d[50] = 50;
+	EXPECT_FATAL_FAILURE(ASSERT_ARRAY_NEAR(a, b, SIZE, 1000));
+	EXPECT_FATAL_FAILURE(ASSERT_ARRAY_NEAR(c, d, SIZE, 1000));
+}
+
+TEST(BulkAssertions, NearWithinUlps) {
+	float a[] = { -1, 0, 1, 1e30f, INFINITY };
+	float b[] = { nextafterf(nextafterf(-1, 0), 0), -0.f, nextafterf(1, 2), 1e30f, INFINITY };
+	double c[] = { 1, -DBL_MIN };
+	double d[] = { nextafter(nextafter(1, 2), 2), DBL_MIN };
+	EXPECT_ARRAY_NEAR_ULPS(a, b, 5, 2);
+	EXPECT_NONFATAL_FAILURE(EXPECT_ARRAY_NEAR_ULPS(a, b, 5, 1), 1);
+	EXPECT_ARRAY_NEAR_ULPS(c, d, 1, 2);
+	EXPECT_NONFATAL_FAILURE(EXPECT_ARRAY_NEAR_ULPS(c, d, 2, 2), 1);
+	float e[] = { -FLT_TRUE_MIN };
+	float f[] = { FLT_TRUE_MIN };
+	EXPECT_ARRAY_NEAR_ULPS(e, f, 1, 2);
+	EXPECT_NONFATAL_FAILURE(EXPECT_ARRAY_NEAR_ULPS(e, f, 1, 1), 1);
+}
+
+TEST(Golden, MatchesReference) {
+	const char *expected = "Hello, golden file!\n";
+	ASSERT_MATCHES_GOLDEN(expected, strlen(expected), "testdata/hello.golden");
+}
+
+TEST(Golden, DifferencesFail) {
+	const char *changed = "Hello, silver file!\n";
+	EXPECT_NONFATAL_FAILURE(EXPECT_MATCHES_GOLDEN(changed, strlen(changed), "testdata/hello.golden"), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_MATCHES_GOLDEN(changed, 6, "testdata/hello.golden"), 1);
+	EXPECT_FATAL_FAILURE(ASSERT_MATCHES_GOLDEN(changed, strlen(changed), "testdata/missing.golden"));
+}
+
+/**
+ * Return what EXPECT_STREQ(a, b) reports, to check the diff it shows. The
+ * caller frees the string.
+ */
+static char *streq_failure(const char *a, const char *b) {
+	char *report;
+	size_t size;
+	struct ctester_test_case_state_t scratch = { .output = open_memstream(&report, &size) };
+	{
+		struct ctester_test_case_state_t *ctester_state = &scratch;
+		EXPECT_STREQ(a, b);
+	}
+	fclose(scratch.output);
+	return report;
+}
+
+TEST(Diff, LinesWithContext) {
+	char a[4096] = "", b[4096] = "";
+	for(int i = 0; i < 200; i++) {
+		sprintf(a + strlen(a), "line %d\n", i);
+		sprintf(b + strlen(b), i == 100 ? "changed\n" : "line %d\n", i);
+	}
+	char *report = streq_failure(a, b);
+	EXPECT_TRUE(strstr(report, "@@ -98,7 +98,7 @@\n") != NULL, "%s", report);
+	EXPECT_TRUE(strstr(report, "     line 97\n") != NULL);
+	EXPECT_TRUE(strstr(report, "    -line 100\n") != NULL);
+	EXPECT_TRUE(strstr(report, "    +changed\n") != NULL);
+	EXPECT_TRUE(strstr(report, "line 96\n") == NULL);
+	free(report);
+}
+
+TEST(Diff, CharactersOfOneLine) {
+	enum { SIZE = 50000 };
+	char *a = malloc(SIZE + 1), *b = malloc(SIZE + 1);
+	for(int i = 0; i < SIZE; i++) {
+		a[i] = b[i] = 'a' + i % 26;
+	}
+	a[SIZE] = b[SIZE] = 0;
+	b[25000] = '!';
+	char *report = streq_failure(a, b);
+	EXPECT_TRUE(strstr(report, "[-o-]{+!+}") != NULL, "%s", report);
+	EXPECT_LT(strlen(report), 1000u);
+	free(report);
+	free(a);
+	free(b);
+}
+
+TEST(Diff, OutputIsBounded) {
+	// Unrelated inputs exceed the cost the diff searches at most, and the size of its output
+	enum { SIZE = 1 << 20 };
+	char *a = malloc(SIZE + 1), *b = malloc(SIZE + 1);
+	uint64_t state = 1;
+	for(int i = 0; i < SIZE; i++) {
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		a[i] = i % 50 == 49 ? '\n' : 'a' + (state >> 59);
+		b[i] = i % 50 == 49 ? '\n' : 'a' + (state >> 54 & 15);
+	}
+	a[SIZE] = b[SIZE] = 0;
+	char *report = streq_failure(a, b);
+	EXPECT_TRUE(strstr(report, "[... diff truncated after") != NULL);
+	EXPECT_LT(strlen(report), 16384u);
+	free(report);
+	a[SIZE / 2] = 0;
+	b[SIZE / 2] = 0;
+	for(int i = 0; i < SIZE / 2; i++) {
+		if(a[i] == '\n') {
+			a[i] = b[i] = ' ';
+		}
+	}
+	report = streq_failure(a, b);
+	EXPECT_LT(strlen(report), 16384u);
+	free(report);
+	// Empty lines cost their prefix and newline
+	memset(a, '\n', SIZE);
+	a[SIZE] = 0;
+	report = streq_failure(a, "x");
+	EXPECT_TRUE(strstr(report, "[... diff truncated after") != NULL);
+	EXPECT_LT(strlen(report), 16384u);
+	free(report);
+	free(a);
+	free(b);
+}
+
+static int *fixture_shared_table;
+static int fixture_set_up_test_case_calls;
+
+FIXTURE(Fixtures) {
+	int *copy;
+	int set_up_ran;
+};
+
+SET_UP_TEST_CASE(Fixtures) {
+	fixture_set_up_test_case_calls++;
+	fixture_shared_table = calloc(10, sizeof(int));
+	ASSERT_NE(fixture_shared_table, NULL);
+	for(int i = 0; i < 10; i++) {
+		fixture_shared_table[i] = i * i;
+	}
+}
+
+TEAR_DOWN_TEST_CASE(Fixtures) {
+	free(fixture_shared_table);
+	fixture_shared_table = NULL;
+}
+
+SET_UP(Fixtures) {
+	fixture->copy = malloc(10 * sizeof(int));
+	memcpy(fixture->copy, fixture_shared_table, 10 * sizeof(int));
+	fixture->set_up_ran = 1;
+}
+
+TEAR_DOWN(Fixtures) {
+	free(fixture->copy);
+}
+
+TEST_F(Fixtures, SharedStateIsSetUpOnce) {
+	ASSERT_NE(fixture_shared_table, NULL);
+	EXPECT_EQ(fixture_set_up_test_case_calls, 1);
+	EXPECT_EQ(fixture_shared_table[3], 9);
+}
+
+TEST_F(Fixtures, EachTestGetsAFreshFixture) {
+	EXPECT_EQ(fixture->set_up_ran, 1);
+	EXPECT_EQ(fixture->copy[4], 16);
+	fixture->copy[4] = 0;
+}
+
+TEST_F(Fixtures, ModificationsDoNotLeak) {
+	EXPECT_EQ(fixture->copy[4], 16);
+}
+
+// The compiler may drop a malloc(3) whose result is only passed to free(3)
+void allocate_and_free(size_t size) {
+	void *volatile pointer = malloc(size);
+	free(pointer);
+}
+
+TEST(Allocations, MaxAllocs) {
+	char buffer[16];
+	ASSERT_MAX_ALLOCS(snprintf(buffer, sizeof(buffer), "%d", 42), 0);
+	ASSERT_MAX_ALLOCS(allocate_and_free(100), 1);
+	EXPECT_NONFATAL_FAILURE(EXPECT_MAX_ALLOCS(allocate_and_free(10); allocate_and_free(10), 1), 1);
+}
+
+TEST(Allocations, NoLeaks) {
+	char *pointer = malloc(1000);
+	pointer = realloc(pointer, 2000);
+	EXPECT_NONFATAL_FAILURE(EXPECT_NO_LEAKS(), 1);
+	free(pointer);
+	ASSERT_NO_LEAKS();
+}
+
+void *allocate_and_free_in_thread(void *argument) {
+	allocate_and_free(100);
+	return argument;
+}
+
+TEST(Allocations, ThreadsDoNotLeak) {
+	pthread_t threads[8];
+	for(int i = 0; i < 8; i++) {
+		ASSERT_EQ(pthread_create(&threads[i], NULL, allocate_and_free_in_thread, NULL), 0);
+	}
+	for(int i = 0; i < 8; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	ASSERT_NO_LEAKS();
+}
+
+void sum_linear(size_t n) {
+	volatile size_t sum = 0;
+	for(size_t i = 0; i < n; i++) {
+		sum += i;
+	}
+}
+
+void sum_quadratic(size_t n) {
+	volatile size_t sum = 0;
+	for(size_t i = 0; i < n; i++) {
+		for(size_t j = 0; j < n; j++) {
+			sum += i * j;
+		}
+	}
+}
+
+TEST(Performance, FasterThan) {
+	ASSERT_FASTER_THAN(sum_linear(10), 1000000);
+	EXPECT_NONFATAL_FAILURE(EXPECT_FASTER_THAN(usleep(1000), 100000), 1);
+}
+
+TEST(Performance, Complexity) {
+	size_t linear_sizes[] = { 1000, 4000, 16000, 64000, 256000 };
+	ASSERT_COMPLEXITY(sum_linear, linear_sizes, O_N_LOG_N);
+	size_t quadratic_sizes[] = { 64, 128, 256, 512, 1024 };
+	EXPECT_NONFATAL_FAILURE(EXPECT_COMPLEXITY(sum_quadratic, quadratic_sizes, O_N), 1);
+}
+
+TEST(Counters, ReadWithinTest) {
+	unsigned long long page_faults = ctester_counter(PAGE_FAULTS);
+	char *buffer = malloc(1 << 20);
+	memset(buffer, 1, 1 << 20);
+	CTESTER_DO_NOT_OPTIMIZE(buffer[1 << 19]);
+	free(buffer);
+	EXPECT_GE(ctester_counter(PAGE_FAULTS), page_faults);
+}
+
+TEST_P(Parameters, Range) {
+	long long value = PARAM_INT(0);
+	ASSERT_GE(value, 10);
+	ASSERT_LT(value, 20);
+	EXPECT_EQ(value % 3, 1);
+}
+
+INSTANTIATE_TEST_CASE_P(Stepped, Parameters, CTESTER_RANGE(10, 20, 3));
+
+TEST_P(Combinations, Product) {
+	long long size = PARAM_INT(0);
+	const char *name = PARAM_VALUE(const char *, 1);
+	double factor = PARAM_VALUE(double, 2);
+	ASSERT_GE(size, 0);
+	ASSERT_LT(size, 4);
+	EXPECT_EQ((int)strlen(name), 3);
+	EXPECT_GT(factor, 0.);
+}
+
+INSTANTIATE_TEST_CASE_P(All, Combinations, CTESTER_COMBINE(
+	CTESTER_RANGE(0, 4, 1),
+	CTESTER_VALUES(const char *, "one", "two"),
+	CTESTER_VALUES(double, .5, 2.)));
+
+PROPERTY(Properties, InputsAreInRange, CTESTER_ANY_INT(-5, 1000), CTESTER_ANY_DOUBLE(.5, 2.), CTESTER_ANY_STRING(1, 8),
+	CTESTER_ANY_ARRAY(CTESTER_ANY_BYTES(0, 4), 0, 3)) {
+	EXPECT_GE(PROPERTY_INT(0), -5);
+	EXPECT_LE(PROPERTY_INT(0), 1000);
+	EXPECT_GE(PROPERTY_DOUBLE(1), .5);
+	EXPECT_LE(PROPERTY_DOUBLE(1), 2.);
+	EXPECT_EQ(strlen(PROPERTY_DATA(char, 2)), PROPERTY_SIZE(2));
+	ASSERT_LE(PROPERTY_SIZE(3), 3u);
+	for(size_t i = 0; i < PROPERTY_SIZE(3); i++) {
+		EXPECT_LE(PROPERTY_DATA(struct ctester_property_value_t, 3)[i].size, 4u);
+	}
+}
+
+PROPERTY(Properties, ReverseTwiceIsIdentity, CTESTER_ANY_ARRAY(CTESTER_ANY_INT(LLONG_MIN, LLONG_MAX), 0, 64)) {
+	size_t size = PROPERTY_SIZE(0);
+	long long values[size + 1];
+	for(size_t i = 0; i < size; i++) {
+		values[i] = PROPERTY_DATA(long long, 0)[size - 1 - i];
+	}
+	for(size_t i = 0; i < size; i++) {
+		EXPECT_EQ(values[size - 1 - i], PROPERTY_DATA(long long, 0)[i]);
+	}
+}
+
+// Inputs the failing properties below ran against last, which are the shrunk ones once they are done
+static long long last_integer;
+static char last_string[16];
+
+void large_integers_fail(struct ctester_test_case_state_t *ctester_state, const struct ctester_property_value_t *ctester_property) {
+	last_integer = PROPERTY_INT(0);
+	EXPECT_LT(PROPERTY_INT(0), 1000);
+}
+
+void strings_with_x_fail(struct ctester_test_case_state_t *ctester_state, const struct ctester_property_value_t *ctester_property) {
+	snprintf(last_string, sizeof(last_string), "%s", PROPERTY_DATA(char, 0));
+	ASSERT_TRUE(strchr(PROPERTY_DATA(char, 0), 'x') == NULL);
+}
+
+static const struct ctester_property_t large_integers_fail_property = {
+	.body = large_integers_fail,
+	.arbitraries = (const struct ctester_arbitrary_t *const[]){ CTESTER_ANY_INT(-100000, 100000) },
+	.count = 1,
+	.file = __FILE__,
+	.line = __LINE__,
+};
+
+static const struct ctester_property_t strings_with_x_fail_property = {
+	.body = strings_with_x_fail,
+	.arbitraries = (const struct ctester_arbitrary_t *const[]){ CTESTER_ANY_STRING(0, 10) },
+	.count = 1,
+	.file = __FILE__,
+	.line = __LINE__,
+};
+
+TEST(Properties, ShrinkToMinimalInput) {
+	EXPECT_FATAL_FAILURE(_ctester_run_property(ctester_state, &large_integers_fail_property));
+	EXPECT_EQ(last_integer, 1000);
+	EXPECT_FATAL_FAILURE(_ctester_run_property(ctester_state, &strings_with_x_fail_property));
+	EXPECT_STREQ((const char *)last_string, "x");
+}
+
+static long long thread_operations;
+
+TEST_THREADS(Threads, AtomicCounter, 2) {
+	ASSERT_LT(CTESTER_THREAD, CTESTER_NUMBER_OF_THREADS);
+	__atomic_add_fetch(&thread_operations, 1, __ATOMIC_RELAXED);
+}
+
+struct expect_from_threads_t {
+	struct ctester_test_case_state_t *ctester_state;
+	int failures;
+};
+
+void *expect_from_thread(void *argument) {
+	struct expect_from_threads_t *arguments = argument;
+	struct ctester_test_case_state_t *ctester_state = arguments->ctester_state;
+	for(int i = 0; i < arguments->failures; i++) {
+		EXPECT_EQ(i, -1);
+	}
+	return NULL;
+}
+
+// Report failures on the given state from several threads at once
+void expect_from_threads(struct ctester_test_case_state_t *ctester_state, int number_of_threads, int failures) {
+	pthread_t threads[number_of_threads];
+	struct expect_from_threads_t arguments = { ctester_state, failures };
+	for(int i = 0; i < number_of_threads; i++) {
+		pthread_create(&threads[i], NULL, expect_from_thread, &arguments);
+	}
+	for(int i = 0; i < number_of_threads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+}
+
+TEST(Threads, SharedStateCountsEveryFailure) {
+	EXPECT_NONFATAL_FAILURE(expect_from_threads(ctester_state, 4, 250), 1000);
+}
+
+// Loop of a TEST_THREADS whose second thread fails right away
+void second_thread_fails(struct ctester_test_case_state_t *ctester_state, int ctester_thread, int ctester_number_of_threads __attribute__((unused)), const int *stop __attribute__((unused)), unsigned long long *operations) {
+	*operations = 1;
+	EXPECT_EQ(ctester_thread, 0);
+}
+
+void second_thread_fails_fatally(struct ctester_test_case_state_t *ctester_state, int ctester_thread, int ctester_number_of_threads __attribute__((unused)), const int *stop __attribute__((unused)), unsigned long long *operations) {
+	*operations = 1;
+	ASSERT_EQ(ctester_thread, 0);
+}
+
+static const struct ctester_threads_t second_thread_fails_threads = {
+	.loop = second_thread_fails,
+	.number_of_threads = 2,
+	.full_test_name = "Threads.SecondThreadFails",
+};
+
+static const struct ctester_threads_t second_thread_fails_fatally_threads = {
+	.loop = second_thread_fails_fatally,
+	.number_of_threads = 2,
+	.full_test_name = "Threads.SecondThreadFailsFatally",
+};
+
+TEST(Threads, FailuresAreMerged) {
+	EXPECT_NONFATAL_FAILURE(_ctester_run_threads(ctester_state, &second_thread_fails_threads), 1);
+	EXPECT_FATAL_FAILURE(_ctester_run_threads(ctester_state, &second_thread_fails_fatally_threads));
+}
+
 /// @}
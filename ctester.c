@@ -19,61 +19,4364 @@
 
 #include "ctester.h"
 
+#include <dlfcn.h>
 #include <getopt.h>
+#include <fcntl.h>
 #include <fnmatch.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <regex.h>
+#include <sched.h>
+#include <execinfo.h>
 #include <stdarg.h>
 #include <unistd.h>
 #include <time.h>
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 #define _CTESTER_STATE_DEFAULT 0
 #define _CTESTER_STATE_SCHEDULED 1
 #define _CTESTER_STATE_FAILED 2
 #define _CTESTER_STATE_SUCCEEDED 3
 
-#define _CTESTER_INFO_WARNING    "   WARN   "
-#define _CTESTER_INFO_THICK_BAR  "=========="
-#define _CTESTER_INFO_THIN_BAR   "----------"
-#define _CTESTER_INFO_RUN        " RUN      "
-#define _CTESTER_INFO_OK         "      OK  "
-#define _CTESTER_INFO_FAILED     "  FAILED  "
-#define _CTESTER_INFO_PASSED     "  PASSED  "
+#define _CTESTER_DEATH_TEST_FORK 0
+#define _CTESTER_DEATH_TEST_VFORK 1
+
+// Size of the pipe for the stderr of vfork(2)ed death test children, which the parent can only drain after they exit
+#define _CTESTER_DEATH_TEST_PIPE_SIZE (1 << 20)
+// Maximum amount of stderr output kept from a death test child
+#define _CTESTER_DEATH_TEST_OUTPUT_LIMIT (1 << 20)
+
+#define _CTESTER_ORDER_NAME 0
+#define _CTESTER_ORDER_FAILED_FIRST 1
+#define _CTESTER_ORDER_SLOWEST_FIRST 2
+
+// Weight of the latest run in the moving average of the run time, in percent
+#define _CTESTER_HISTORY_WEIGHT 30
+
+#define _CTESTER_INFO_WARNING    "   WARN   "
+#define _CTESTER_INFO_THICK_BAR  "=========="
+#define _CTESTER_INFO_THIN_BAR   "----------"
+#define _CTESTER_INFO_RUN        " RUN      "
+#define _CTESTER_INFO_OK         "      OK  "
+#define _CTESTER_INFO_FAILED     "  FAILED  "
+#define _CTESTER_INFO_PASSED     "  PASSED  "
+#define _CTESTER_INFO_BENCH      "   BENCH  "
+#define _CTESTER_INFO_SLOW       "   SLOW   "
+#define _CTESTER_INFO_FLAKY      "  FLAKY   "
+#define _CTESTER_INFO_SCALE      "   SCALE  "
+
+#define _CTESTER_BENCHMARK_SAMPLES 100
+
+// Number of times a failing input of a ::PROPERTY is run while shrinking it, at most
+#define _CTESTER_PROPERTY_MAX_SHRINK_ATTEMPTS 10000
+
+#define _CTESTER_WATCHDOG_SIGNAL SIGRTMIN
+#define _CTESTER_WATCHDOG_TEST 0
+#define _CTESTER_WATCHDOG_DEADLINE 1
+
+struct ctester_test_case_list_t *ctester_tests;
+int ctester_number_of_tests;
+
+// Bounds of the `ctester_tests` section, see ::_CTESTER_REGISTER
+extern struct ctester_test_case_list_t *__start_ctester_tests[] __attribute__((weak));
+extern struct ctester_test_case_list_t *__stop_ctester_tests[] __attribute__((weak));
+extern const struct ctester_instantiation_t *__start_ctester_instantiations[] __attribute__((weak));
+extern const struct ctester_instantiation_t *__stop_ctester_instantiations[] __attribute__((weak));
+// Registrations of the tests linked into this binary
+static const struct ctester_module_t binary_module = {
+	.tests_start = __start_ctester_tests,
+	.tests_stop = __stop_ctester_tests,
+	.instantiations_start = __start_ctester_instantiations,
+	.instantiations_stop = __stop_ctester_instantiations,
+};
+// Only defined if allocations are tracked, see ctester-alloc.c
+extern struct ctester_alloc_stats_t ctester_alloc_stats __attribute__((weak));
+_Thread_local int _ctester_alloc_untracked;
+
+/**
+ * Outcome of a single test, no matter whether it ran in this process or in a
+ * worker.
+ */
+struct ctester_test_result_t {
+	int failed;                       //<<< Line number where a failure occurred, -1 if the test's process died
+	int warning;                      //<<< Number of warnings issued from the test
+	int status;                       //<<< waitpid(2) status of the process that died running the test
+	unsigned long long duration;      //<<< Total run time in nanoseconds
+	unsigned long long body_duration; //<<< Time spent in the test body in nanoseconds, the rest is setup
+	int timed_out;                    //<<< Whether the test was stopped by the watchdog, see `--timeout-ms`
+	int has_usage;                    //<<< Whether ::usage is valid, i.e. whether the test ran isolated
+	struct rusage usage;              //<<< Resources used by the test's process, see `--isolate`
+	int has_allocs;                   //<<< Whether ::allocs is valid, i.e. whether allocations are tracked
+	struct ctester_alloc_stats_t allocs; //<<< Heap allocations of the test, see `ctester-alloc.c`
+	unsigned counters_mask;           //<<< Bit mask of the valid ::counters, see `--counters`
+	unsigned long long counters[_CTESTER_NUMBER_OF_COUNTERS]; //<<< Performance counters of the test body
+	char *output;                     //<<< Captured output of the test, or NULL, see `--capture`
+	size_t output_size;               //<<< Size of ::output
+};
+
+/**
+ * Options given on the command line that influence how tests are executed.
+ */
+struct ctester_options_t {
+	int isolate;                     //<<< Run each test in its own child process
+	unsigned long max_rss;           //<<< Memory limit for isolated tests in MiB, or 0
+	unsigned long max_address_space; //<<< Address space limit for isolated tests in MiB, or 0
+	unsigned long max_cpu;           //<<< CPU time limit for isolated tests in seconds, or 0
+	int bench;                       //<<< Run benchmarks instead of tests
+	unsigned long bench_time;        //<<< Target run time per benchmark in milliseconds
+	int slowest;                     //<<< Number of slowest tests to list after the run
+	unsigned long timeout_ms;        //<<< Time limit per test (and per death test child) in milliseconds, or 0
+	unsigned long deadline;          //<<< Time limit for the whole run in seconds, or 0
+	int shard_index;                 //<<< Index of the shard to run
+	int total_shards;                //<<< Number of shards the tests are split into
+	const char *timings_file;        //<<< File with the run times of a previous run, or NULL
+	const char *save_timings_file;   //<<< File to store the run times of this run in, or NULL
+	int capture;                     //<<< Capture the output of tests, or -1 to decide automatically
+	int output_on_failure;           //<<< Only print the captured output of failed tests
+	const char *history_file;        //<<< File with the outcome of previous runs, or NULL
+	int order;                       //<<< Order to run tests in, one of the `_CTESTER_ORDER_*` constants
+	int last_failed;                 //<<< Only run the tests that failed in the previous run
+	int death_test_style;            //<<< How death tests create children, one of the `_CTESTER_DEATH_TEST_*` constants
+	unsigned counters;               //<<< Bit mask of the performance counters to open, see ::ctester_counter
+	int repeat;                      //<<< Number of times to run the tests, or 0 if not given
+	int until_fail;                  //<<< Stop repeating after the first iteration with a failure
+	int shuffle;                     //<<< Run the tests in random order
+	int seed_given;                  //<<< Whether ::seed was given on the command line
+	uint64_t seed;                   //<<< Seed of the random order
+	unsigned long property_runs;     //<<< Maximum number of inputs each ::PROPERTY is run against
+	unsigned long property_time_ms;  //<<< Time limit for finding a failing input per ::PROPERTY in milliseconds, or 0
+	int property_seed_given;         //<<< Whether ::property_seed was given on the command line
+	uint64_t property_seed;          //<<< Seed of the inputs of properties
+	unsigned long threads_time_ms;   //<<< Run time of each round of a ::TEST_THREADS in milliseconds
+	int update_golden;               //<<< Replace golden files that do not match instead of failing, see ::ASSERT_MATCHES_GOLDEN
+};
+
+/**
+ * A performance counter available through `--counters`.
+ */
+struct ctester_counter_event_t {
+	const char *name; //<<< Name on the command line and in reports
+	uint32_t type;    //<<< Event type for perf_event_open(2)
+	uint64_t config;  //<<< Event within ::type
+};
+
+/**
+ * Value of a performance counter, as read(2) from its file descriptor.
+ */
+struct ctester_counter_reading_t {
+	uint64_t value;        //<<< Number of events counted
+	uint64_t time_enabled; //<<< Time the counter was enabled, in nanoseconds
+	uint64_t time_running; //<<< Time the counter was actually counting, which is less if counters are multiplexed
+};
+
+/**
+ * Outcome of previous runs of a test, see `--history`.
+ */
+struct ctester_history_t {
+	int known;                            //<<< Whether the test ran before
+	int failed;                           //<<< Whether the test failed in its last run
+	unsigned long long average_duration;  //<<< Moving average of its run time in nanoseconds
+};
+
+/**
+ * Outcome of the runs of a test with `--repeat` or `--until-fail`.
+ */
+struct ctester_repeat_stats_t {
+	unsigned passed;           //<<< Number of runs that passed
+	unsigned failed;           //<<< Number of runs that failed
+	double mean_duration;      //<<< Mean run time in nanoseconds
+	double squared_deviations; //<<< Sum of the squared deviations from ::mean_duration
+};
+
+/**
+ * Random choices from which the inputs of a ::PROPERTY are generated.
+ *
+ * Inputs are not shrunk directly, but by shrinking the choices and generating
+ * them anew, which works for any generator. Smaller choices generate simpler
+ * inputs.
+ */
+struct ctester_property_run_t {
+	uint64_t *choices;            //<<< Choices made so far, or to be replayed
+	size_t number_of_choices;     //<<< Number of valid ::choices
+	size_t capacity;              //<<< Allocated size of ::choices
+	size_t position;              //<<< Index of the next choice
+	int replay;                   //<<< Whether to replay ::choices, with zeros past their end, instead of drawing new ones
+	uint64_t random;              //<<< State of the random number generator
+	void **allocations;           //<<< Memory holding the current inputs
+	size_t number_of_allocations; //<<< Number of valid ::allocations
+	size_t allocations_capacity;  //<<< Allocated size of ::allocations
+};
+
+/**
+ * A thread running the body of a ::TEST_THREADS.
+ */
+struct ctester_thread_t {
+	pthread_t thread;                        //<<< The thread
+	const struct ctester_threads_t *threads; //<<< Test the thread runs
+	int index;                               //<<< Index of the thread, see ::CTESTER_THREAD
+	int number_of_threads;                   //<<< Number of threads in the current round
+	pthread_barrier_t *barrier;              //<<< Barrier all threads start the body at
+	const int *stop;                         //<<< Set once the threads should stop
+	int *finished;                           //<<< Number of threads that stopped running the body
+	struct ctester_test_case_state_t state;  //<<< State of the thread, merged into the test's state once it finished
+	char *output;                            //<<< Failure messages of the thread
+	size_t output_size;                      //<<< Size of ::output
+	unsigned long long operations;           //<<< Number of times the thread ran the body
+};
+
+/**
+ * Statistics on the time per operation of a benchmark, in nanoseconds.
+ */
+struct ctester_benchmark_stats_t {
+	double mean;              //<<< Arithmetic mean
+	double median;            //<<< Median
+	double stddev;            //<<< Sample standard deviation
+	double min;               //<<< Fastest sample
+	double p99;               //<<< 99th percentile
+	unsigned long iterations; //<<< Iterations per sample
+};
+
+/**
+ * Run time of a test, used to find the slowest tests.
+ */
+struct ctester_test_timing_t {
+	struct ctester_test_case_list_t *test; //<<< The test
+	unsigned long long duration;           //<<< Its total run time in nanoseconds
+};
+
+/**
+ * A forked worker process executing tests on behalf of ::main.
+ */
+struct ctester_worker_t {
+	pid_t pid;                     //<<< Process id of the worker
+	int command_fd;                //<<< Pipe the worker reads test indices from
+	int result_fd;                 //<<< Pipe the worker writes results to
+	int current;                   //<<< Index of the test the worker is running, or -1 if idle
+	unsigned long long start_time; //<<< Time at which the current test was handed out
+	int capture_fd;                //<<< File the worker captures the output of tests in, or -1
+};
+
+/**
+ * Message sent from a worker to the parent after each test.
+ */
+struct ctester_worker_message_t {
+	int index;                            //<<< Index of the test in the schedule
+	struct ctester_test_result_t result;  //<<< Result of the test
+};
+
+/**
+ * Pool of workers pulling tests from the schedule, see `-j`.
+ */
+struct ctester_pool_t {
+	struct ctester_worker_t *workers;           //<<< Worker processes
+	int number_of_workers;                      //<<< Size of ::workers
+	struct ctester_test_case_list_t **schedule; //<<< Tests to run, in order
+	int schedule_length;                        //<<< Number of tests in ::schedule
+	int next_index;                             //<<< Next test to hand out to an idle worker
+	struct ctester_test_result_t *results;      //<<< Results, indexed like ::schedule
+	char *done;                                 //<<< Whether the result for a test has arrived
+};
+
+/**
+ * State of the watchdog enforcing `--timeout-ms` and `--deadline`.
+ *
+ * Everything in here is read from the signal handler, which is why the message
+ * to send to the parent on a timeout is prepared before the test runs. The
+ * handler only writes with write(2), as stdio is not async-signal-safe.
+ */
+struct ctester_watchdog_t {
+	timer_t test_timer;                     //<<< Timer for the current test
+	int test_timer_created;                 //<<< Whether ::test_timer exists in this process
+	timer_t deadline_timer;                 //<<< Timer for the whole run
+	struct ctester_test_case_list_t *test;  //<<< Test running in this process, or NULL
+	volatile pid_t death_child;             //<<< Death test child being waited for, or 0
+	volatile pid_t isolated_child;          //<<< Child running an isolated test, or 0
+	struct ctester_pool_t *pool;            //<<< Pool of workers, or NULL
+	int stdout_is_tty;                      //<<< Whether the report of a timed out test is colored
+	int result_fd;                          //<<< Where to send ::message on a timeout, or -1 to abort
+	char message[sizeof(struct ctester_worker_message_t)]; //<<< Message announcing a timeout to the parent
+	size_t message_size;                    //<<< Size of ::message
+};
+
+struct ctester_reporter_t;
+
+/**
+ * A report format, see `--output`.
+ *
+ * Reports are written while the tests run, and kept valid on disk after each
+ * test, such that a run that crashes still leaves a usable report.
+ */
+struct ctester_reporter_type_t {
+	const char *name;                                                         //<<< Name of the format on the command line
+	void (*begin)(struct ctester_reporter_t *);                               //<<< Start the report
+	void (*test_case_begin)(struct ctester_reporter_t *, const char *, int);  //<<< A test case with a number of tests starts, or NULL
+	void (*test_end)(struct ctester_reporter_t *, struct ctester_test_case_list_t *, struct ctester_test_result_t *, struct ctester_benchmark_stats_t *, const char *); //<<< Report a test, its benchmark statistics or NULL, and a description of its failure or NULL
+	void (*test_case_end)(struct ctester_reporter_t *);                       //<<< The current test case ends, or NULL
+	void (*end)(struct ctester_reporter_t *, unsigned, unsigned, unsigned, unsigned long long); //<<< Finish the report with the number of passed, failed and disabled tests, and the overall run time
+	const char *(*tail)(struct ctester_reporter_t *);                         //<<< Text that completes the report written so far
+};
+
+/**
+ * A report being written, see `--output`.
+ */
+struct ctester_reporter_t {
+	const struct ctester_reporter_type_t *type; //<<< Format of the report
+	FILE *file;                                 //<<< File the report is written to
+	int seekable;                               //<<< Whether ::file allows to keep the report valid on disk
+	int in_test_case;                           //<<< Whether a test case has been started
+	int number_of_tests;                        //<<< Number of tests written so far
+};
+
+/**
+ * A set of tests, either those linked into this binary or those of a shared
+ * object loaded from the command line, see ::load_module.
+ */
+struct ctester_loaded_module_t {
+	const char *file_name;                   //<<< Path of the shared object, or the name of this binary
+	void *handle;                            //<<< dlopen(3) handle, or NULL for this binary
+	const struct ctester_module_t *sections; //<<< Registrations of the tests
+};
+
+static struct ctester_options_t options = {
+	.bench_time = 500,
+	.property_runs = 1000,
+	.threads_time_ms = 100,
+	.total_shards = 1,
+	.capture = -1,
+};
+
+static struct ctester_watchdog_t watchdog = {
+	.result_fd = -1,
+};
+
+static struct ctester_reporter_t *reporters;
+static int number_of_reporters;
+
+// Indexed by the `_CTESTER_COUNTER_*` constants
+static const struct ctester_counter_event_t counter_events[_CTESTER_NUMBER_OF_COUNTERS] = {
+	{ "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ "task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+	{ "page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+	{ "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+};
+
+/**
+ * Performance counters of this process, see `--counters`.
+ *
+ * Counters only count the process that opened them, so workers and isolated
+ * tests open their own.
+ */
+static struct {
+	pid_t pid;                                                          //<<< Process that opened the counters, or 0
+	int fds[_CTESTER_NUMBER_OF_COUNTERS];                               //<<< File descriptors of the counters, or -1
+	struct ctester_counter_reading_t start[_CTESTER_NUMBER_OF_COUNTERS]; //<<< Values at the start of the current test
+} counters;
+
+// The tests of this binary come first
+static struct ctester_loaded_module_t *modules;
+static int number_of_modules;
+
+// Indexed like ::ctester_tests
+static struct ctester_history_t *history;
+
+// Indexed like ::ctester_tests, only allocated if the tests run more than once
+static struct ctester_repeat_stats_t *repeat_stats;
+
+/**
+ * Test case whose ::SET_UP_TEST_CASE hook ran in this process, see
+ * ::enter_test_case.
+ */
+static struct {
+	struct ctester_test_case_list_t *test; //<<< A test of the case, or NULL if outside of a test case
+	int failed;                            //<<< Line at which the hook failed, or 0
+} current_test_case;
+
+/**
+ * Redirection of the output of tests running in this process, see
+ * `--capture`.
+ */
+static struct {
+	int fd;                      //<<< File receiving the output, or -1 if not capturing
+	int saved_stdout;            //<<< Original stdout while capturing
+	int saved_stderr;            //<<< Original stderr while capturing
+	int active;                  //<<< Whether output is being captured right now
+	char stderr_buffer[BUFSIZ];  //<<< Buffer for stderr while capturing
+} capture = {
+	.fd = -1,
+};
+
+/**
+ * printf(), but output `info` in ANSI color code `color` preceding the normal
+ * output.
+ */
+static void print_info(int color, char *info, char *format, ...) {
+	static int fp_1_is_tty = -1;
+
+	if(fp_1_is_tty < 0) {
+		fp_1_is_tty = isatty(1);
+	}
+
+	va_list args;
+	va_start(args, format);
+
+	if(fp_1_is_tty) {
+		printf("\033[%dm[%s]\033[0m ", color, info);
+	}
+	else {
+		printf("[%s] ", info);
+	}
+	vprintf(format, args);
+}
+
+/**
+ * Return number of wall-clock nanoseconds since some fixed date. Only deltas
+ * of the returned value are used.
+ */
+static unsigned long long get_clock_ns() {
+	struct timespec tp;
+	if(clock_gettime(CLOCK_MONOTONIC, &tp) == -1) {
+		print_info(33, _CTESTER_INFO_WARNING, "Failed to retrieve value of monotonic clock. Timing info will be wrong.\n");
+		return 0;
+	}
+	return tp.tv_sec * 1000000000ULL + tp.tv_nsec;
+}
+
+/**
+ * Format a duration given in nanoseconds using an appropriate unit. Returns
+ * `buffer`.
+ */
+static char *format_duration(char *buffer, size_t size, unsigned long long duration) {
+	if(duration < 1000ULL) {
+		snprintf(buffer, size, "%llu ns", duration);
+	}
+	else if(duration < 1000000ULL) {
+		snprintf(buffer, size, "%.1f \u00b5s", duration / 1e3);
+	}
+	else if(duration < 1000000000ULL) {
+		snprintf(buffer, size, "%.1f ms", duration / 1e6);
+	}
+	else {
+		snprintf(buffer, size, "%.2f s", duration / 1e9);
+	}
+	return buffer;
+}
+
+/**
+ * Format a number of bytes with a binary unit into `buffer`.
+ */
+static char *format_bytes(char *buffer, size_t size, unsigned long long bytes) {
+	if(bytes < 1024) {
+		snprintf(buffer, size, "%llu B", bytes);
+	}
+	else if(bytes < 1024 * 1024) {
+		snprintf(buffer, size, "%.1f KiB", bytes / 1024.);
+	}
+	else {
+		snprintf(buffer, size, "%.1f MiB", bytes / (1024. * 1024.));
+	}
+	return buffer;
+}
+
+/**
+ * Format a number of operations per second in a human readable way.
+ */
+static char *format_rate(char *buffer, size_t size, double rate) {
+	if(rate < 1e3) {
+		snprintf(buffer, size, "%.1f ops/s", rate);
+	}
+	else if(rate < 1e6) {
+		snprintf(buffer, size, "%.1f K ops/s", rate / 1e3);
+	}
+	else if(rate < 1e9) {
+		snprintf(buffer, size, "%.1f M ops/s", rate / 1e6);
+	}
+	else {
+		snprintf(buffer, size, "%.1f G ops/s", rate / 1e9);
+	}
+	return buffer;
+}
+
+/**
+ * Print the total time and its split into test bodies and setup, as part of
+ * an info line.
+ */
+static void print_durations(unsigned long long duration, unsigned long long body_duration) {
+	char total[32], body[32], setup[32];
+	format_duration(total, sizeof(total), duration);
+	if(duration > body_duration) {
+		format_duration(body, sizeof(body), body_duration);
+		format_duration(setup, sizeof(setup), duration - body_duration);
+		printf("%s total, %s body, %s setup", total, body, setup);
+	}
+	else {
+		printf("%s total", total);
+	}
+}
+
+/**
+ * read(2) exactly `size` bytes unless the other end goes away. Returns the
+ * number of bytes read.
+ */
+static ssize_t read_full(int fd, void *buffer, size_t size) {
+	size_t position = 0;
+	while(position < size) {
+		ssize_t ret = read(fd, (char *)buffer + position, size - position);
+		if(ret < 0 && errno == EINTR) {
+			continue;
+		}
+		if(ret <= 0) {
+			break;
+		}
+		position += ret;
+	}
+	return position;
+}
+
+/**
+ * write(2) all of `size` bytes. Returns -1 on failure.
+ */
+static int write_full(int fd, const void *buffer, size_t size) {
+	size_t position = 0;
+	while(position < size) {
+		ssize_t ret = write(fd, (const char *)buffer + position, size - position);
+		if(ret < 0 && errno == EINTR) {
+			continue;
+		}
+		if(ret < 0) {
+			return -1;
+		}
+		position += ret;
+	}
+	return 0;
+}
+
+/**
+ * Create an anonymous file to capture the output of tests in.
+ */
+static int capture_create() {
+	int fd = -1;
+#ifdef MFD_CLOEXEC
+	fd = memfd_create("ctester-output", 0);
+#endif
+	if(fd < 0) {
+		FILE *file = tmpfile();
+		if(file) {
+			fd = dup(fileno(file));
+			fclose(file);
+		}
+	}
+	if(fd < 0) {
+		print_info(33, _CTESTER_INFO_WARNING, "Failed to create a file to capture test output in: %s\n", strerror(errno));
+	}
+	return fd;
+}
+
+/**
+ * Redirect stdout and stderr into the capture file, which is emptied first.
+ *
+ * stderr is fully buffered meanwhile, such that the many small writes of the
+ * assertion macros end up in the file in few write(2) calls.
+ */
+static void capture_begin() {
+	if(capture.fd < 0) {
+		return;
+	}
+	fflush(stdout);
+	fflush(stderr);
+	if(ftruncate(capture.fd, 0) < 0) {
+		print_info(33, _CTESTER_INFO_WARNING, "Failed to empty the capture file: %s\n", strerror(errno));
+	}
+	lseek(capture.fd, 0, SEEK_SET);
+	capture.saved_stdout = dup(1);
+	capture.saved_stderr = dup(2);
+	dup2(capture.fd, 1);
+	dup2(capture.fd, 2);
+	setvbuf(stderr, capture.stderr_buffer, _IOFBF, sizeof(capture.stderr_buffer));
+	capture.active = 1;
+}
+
+/**
+ * Undo ::capture_begin.
+ */
+static void capture_end() {
+	if(capture.fd < 0) {
+		return;
+	}
+	fflush(stdout);
+	fflush(stderr);
+	setvbuf(stderr, NULL, _IONBF, 0);
+	capture.active = 0;
+	dup2(capture.saved_stdout, 1);
+	dup2(capture.saved_stderr, 2);
+	close(capture.saved_stdout);
+	close(capture.saved_stderr);
+}
+
+/**
+ * Store the contents of a capture file in `result`.
+ */
+static void capture_read(int fd, struct ctester_test_result_t *result) {
+	struct stat stat_buffer;
+	result->output = NULL;
+	result->output_size = 0;
+	if(fd < 0 || fstat(fd, &stat_buffer) < 0 || stat_buffer.st_size == 0) {
+		return;
+	}
+	result->output = malloc(stat_buffer.st_size);
+	ssize_t size = pread(fd, result->output, stat_buffer.st_size, 0);
+	result->output_size = size > 0 ? size : 0;
+}
+
+/**
+ * write(2) a string to `fd` from within a signal handler.
+ */
+static void watchdog_print(int fd, const char *string) {
+	write_full(fd, string, strlen(string));
+}
+
+/**
+ * write(2) a number to `fd` from within a signal handler, where printf(3) is
+ * not async-signal-safe.
+ */
+static void watchdog_print_number(int fd, unsigned long number) {
+	char buffer[24];
+	char *digit = buffer + sizeof(buffer);
+	do {
+		*--digit = '0' + number % 10;
+		number /= 10;
+	} while(number);
+	write_full(fd, digit, buffer + sizeof(buffer) - digit);
+}
+
+/**
+ * Stop a child process from within the watchdog, such that it dumps its own
+ * backtrace first if it has a watchdog, too.
+ */
+static void watchdog_stop_child(pid_t pid, int signal) {
+	kill(pid, signal);
+	while(waitpid(pid, NULL, 0) < 0 && errno == EINTR);
+}
+
+/**
+ * Handler for ::_CTESTER_WATCHDOG_SIGNAL.
+ *
+ * If this process runs a test, report it as hung and dump a backtrace. A
+ * worker or isolated child then sends the prepared result to its parent and
+ * exits, such that the run continues. A test running within the main process
+ * cannot be abandoned safely, so the run is aborted.
+ */
+static void watchdog_handler(int signal, siginfo_t *info, void *context) {
+	(void)context;
+	int deadline = info->si_code != SI_TIMER || info->si_value.sival_int == _CTESTER_WATCHDOG_DEADLINE;
+
+	if(watchdog.death_child > 0) {
+		watchdog_stop_child(watchdog.death_child, SIGKILL);
+	}
+
+	if(watchdog.test) {
+		if(deadline) {
+			watchdog_print(2, _CTESTER_INDENT "Deadline of the run exceeded while running ");
+			watchdog_print(2, watchdog.test->full_test_name);
+			watchdog_print(2, ". Backtrace:\n");
+		}
+		else {
+			watchdog_print(2, _CTESTER_INDENT);
+			watchdog_print(2, watchdog.test->full_test_name);
+			watchdog_print(2, " timed out after ");
+			watchdog_print_number(2, options.timeout_ms);
+			watchdog_print(2, " ms. Backtrace:\n");
+		}
+		void *frames[64];
+		backtrace_symbols_fd(frames, backtrace(frames, 64), 2);
+	}
+
+	if(watchdog.isolated_child > 0) {
+		watchdog_stop_child(watchdog.isolated_child, signal);
+	}
+
+	if(watchdog.result_fd >= 0) {
+		// This is a worker or an isolated child; the parent carries on
+		if(!deadline) {
+			write_full(watchdog.result_fd, watchdog.message, watchdog.message_size);
+		}
+		_exit(1);
+	}
+
+	if(deadline && !watchdog.test) {
+		watchdog_print(2, _CTESTER_INDENT "Deadline of ");
+		watchdog_print_number(2, options.deadline);
+		watchdog_print(2, " s for the run exceeded.\n");
+	}
+	if(watchdog.pool) {
+		for(int i = 0; i < watchdog.pool->number_of_workers; i++) {
+			struct ctester_worker_t *worker = &watchdog.pool->workers[i];
+			if(worker->pid > 0 && worker->current >= 0) {
+				watchdog_stop_child(worker->pid, signal);
+			}
+		}
+	}
+	if(watchdog.test) {
+		// Like print_info, which uses stdio
+		watchdog_print(1, watchdog.stdout_is_tty ? "\033[31m[" _CTESTER_INFO_FAILED "]\033[0m " : "[" _CTESTER_INFO_FAILED "] ");
+		watchdog_print(1, watchdog.test->full_test_name);
+		watchdog_print(1, " (timed out)\n");
+	}
+	if(deadline) {
+		watchdog_print(2, "\n\n ABORTED, the deadline of ");
+		watchdog_print_number(2, options.deadline);
+		watchdog_print(2, " s was exceeded.\n");
+	}
+	else {
+		watchdog_print(2, "\n\n ABORTED. Use --isolate or -j to continue after a test times out.\n");
+	}
+	_exit(1);
+}
+
+/**
+ * Install the watchdog's signal handler and start the timer for `--deadline`.
+ */
+static void watchdog_start() {
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_sigaction = &watchdog_handler;
+	action.sa_flags = SA_SIGINFO;
+	sigemptyset(&action.sa_mask);
+	sigaction(_CTESTER_WATCHDOG_SIGNAL, &action, NULL);
+
+	watchdog.stdout_is_tty = isatty(1);
+
+	// backtrace(3) loads libgcc on its first call, which must not happen within the handler
+	void *frame;
+	backtrace(&frame, 1);
+
+	if(options.deadline) {
+		struct sigevent event;
+		memset(&event, 0, sizeof(event));
+		event.sigev_notify = SIGEV_SIGNAL;
+		event.sigev_signo = _CTESTER_WATCHDOG_SIGNAL;
+		event.sigev_value.sival_int = _CTESTER_WATCHDOG_DEADLINE;
+		struct itimerspec expiry = { .it_value = { .tv_sec = options.deadline } };
+		if(timer_create(CLOCK_MONOTONIC, &event, &watchdog.deadline_timer) < 0 || timer_settime(watchdog.deadline_timer, 0, &expiry, NULL) < 0) {
+			print_info(33, _CTESTER_INFO_WARNING, "Failed to set up a timer for the deadline: %s\n", strerror(errno));
+		}
+	}
+}
+
+/**
+ * Forget about timers inherited through fork(2); they do not exist in the
+ * child.
+ */
+static void watchdog_forked() {
+	watchdog.test_timer_created = 0;
+	watchdog.isolated_child = 0;
+	watchdog.pool = NULL;
+}
+
+/**
+ * Start (`milliseconds` > 0) or stop (0) the timer for the current test.
+ */
+static void watchdog_arm(unsigned long milliseconds) {
+	if(!watchdog.test_timer_created) {
+		struct sigevent event;
+		memset(&event, 0, sizeof(event));
+		event.sigev_notify = SIGEV_SIGNAL;
+		event.sigev_signo = _CTESTER_WATCHDOG_SIGNAL;
+		event.sigev_value.sival_int = _CTESTER_WATCHDOG_TEST;
+		if(timer_create(CLOCK_MONOTONIC, &event, &watchdog.test_timer) < 0) {
+			print_info(33, _CTESTER_INFO_WARNING, "Failed to set up a timer for the test timeout: %s\n", strerror(errno));
+			return;
+		}
+		watchdog.test_timer_created = 1;
+	}
+	struct itimerspec expiry = { .it_value = { .tv_sec = milliseconds / 1000, .tv_nsec = (milliseconds % 1000) * 1000000 } };
+	timer_settime(watchdog.test_timer, 0, &expiry, NULL);
+}
+
+// Remaining time of the test timer, which is paused while a death test child runs
+static struct itimerspec death_test_paused_timer;
+
+void _ctester_child_prepare(struct ctester_child_t *child, int allow_vfork) {
+	memset(child, 0, sizeof(struct ctester_child_t));
+	child->use_vfork = allow_vfork && options.death_test_style == _CTESTER_DEATH_TEST_VFORK;
+	child->output_fd = -1;
+	child->child_fd = -1;
+
+	int fds[2];
+	if(pipe2(fds, O_CLOEXEC) == 0) {
+		child->output_fd = fds[0];
+		child->child_fd = fds[1];
+		fcntl(child->output_fd, F_SETFL, O_NONBLOCK);
+		if(child->use_vfork) {
+			// The parent is suspended until the child exits, so the child must
+			// never block on a full pipe
+			fcntl(child->child_fd, F_SETPIPE_SZ, _CTESTER_DEATH_TEST_PIPE_SIZE);
+			fcntl(child->child_fd, F_SETFL, O_NONBLOCK);
+		}
+	}
+
+	// Children of a process ignoring SIGCHLD are reaped automatically
+	struct sigaction action;
+	if(sigaction(SIGCHLD, NULL, &action) == 0 && action.sa_handler == SIG_IGN) {
+		signal(SIGCHLD, SIG_DFL);
+		child->restore_sigchld = 1;
+	}
+
+	// Pause the test's own timer, such that the child gets a full timeout and a
+	// hanging child fails the assertion instead of the whole test
+	memset(&death_test_paused_timer, 0, sizeof(death_test_paused_timer));
+	if(watchdog.test_timer_created) {
+		struct itimerspec stopped = { { 0, 0 }, { 0, 0 } };
+		timer_settime(watchdog.test_timer, 0, &stopped, &death_test_paused_timer);
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	if(child->use_vfork) {
+		// Messages printed right before a crash must not stay in a buffer. A
+		// vfork(2)ed child shares our stderr stream, so it is unbuffered here
+		// rather than in the child, see _ctester_child_started
+		setvbuf(stderr, NULL, _IONBF, 0);
+	}
+}
+
+void _ctester_child_started(struct ctester_child_t *child) {
+	// A vfork(2)ed child runs on the memory of the parent, so everything up to
+	// the statement must be async-signal-safe and leave stdio alone
+	if(child->child_fd >= 0) {
+		close(child->output_fd);
+		dup2(child->child_fd, 2);
+		close(child->child_fd);
+	}
+	if(!child->use_vfork) {
+		// Messages printed right before a crash must not stay in a buffer
+		setvbuf(stderr, NULL, _IONBF, 0);
+	}
+	else if(options.timeout_ms) {
+		// The parent cannot kill the child while it is suspended, so the child
+		// times itself out
+		struct itimerval timer = { { 0, 0 }, { options.timeout_ms / 1000, (options.timeout_ms % 1000) * 1000 } };
+		struct sigaction action = { .sa_handler = SIG_DFL };
+		sigaction(SIGALRM, &action, NULL);
+		setitimer(ITIMER_REAL, &timer, NULL);
+	}
+}
+
+void _ctester_child_exit(struct ctester_child_t *child, int exit_code) {
+	if(child->use_vfork) {
+		// exit(3) would run the exit handlers and flush the streams of the parent
+		_exit(exit_code);
+	}
+	exit(exit_code);
+}
+
+/**
+ * Read what is available from the stderr pipe of a death test child, closing
+ * the pipe once the child closed its end.
+ */
+static void child_read_output(struct ctester_child_t *child) {
+	char buffer[4096];
+	while(child->output_fd >= 0) {
+		ssize_t size = read(child->output_fd, buffer, sizeof(buffer));
+		if(size < 0 && errno == EINTR) {
+			continue;
+		}
+		if(size < 0 && errno == EAGAIN) {
+			break;
+		}
+		if(size <= 0) {
+			close(child->output_fd);
+			child->output_fd = -1;
+			break;
+		}
+		if(child->output_size + size > _CTESTER_DEATH_TEST_OUTPUT_LIMIT) {
+			size = _CTESTER_DEATH_TEST_OUTPUT_LIMIT - child->output_size;
+		}
+		child->output = realloc(child->output, child->output_size + size + 1);
+		memcpy(child->output + child->output_size, buffer, size);
+		child->output_size += size;
+		child->output[child->output_size] = 0;
+	}
+}
+
+/**
+ * Wait for a child created by ::_CTESTER_TEST_RUN_AS_CHILD, for at most
+ * `--timeout-ms` milliseconds, while collecting its stderr. Returns -1 if the
+ * child had to be killed because it timed out, 0 otherwise.
+ */
+int _ctester_wait_child(struct ctester_child_t *child, pid_t child_pid, int *status, const char *file, int line) {
+	unsigned long long wait_start_time = get_clock_ns();
+	unsigned long long poll_interval = 100000;
+	int timed_out = 0;
+
+	if(child->child_fd >= 0) {
+		close(child->child_fd);
+		child->child_fd = -1;
+	}
+	if(child->use_vfork) {
+		// Undo the unbuffering of stderr in _ctester_child_prepare
+		if(capture.active) {
+			setvbuf(stderr, capture.stderr_buffer, _IOFBF, sizeof(capture.stderr_buffer));
+		}
+		else {
+			setvbuf(stderr, NULL, _IONBF, 0);
+		}
+	}
+
+	watchdog.death_child = child_pid;
+	while(child_pid > 0) {
+		child_read_output(child);
+		pid_t ret = waitpid(child_pid, status, WNOHANG);
+		if(ret == child_pid) {
+			break;
+		}
+		if(ret < 0 && errno != EINTR) {
+			fprintf(stderr, _CTESTER_INDENT "%s:%d: Warning.\n" _CTESTER_INDENT "    waitpid(2) returned an error: %s (%d)\n", file, line, strerror(errno), errno);
+			break;
+		}
+		if(ret == 0 && options.timeout_ms && !timed_out && get_clock_ns() - wait_start_time > options.timeout_ms * 1000000ULL) {
+			kill(child_pid, SIGKILL);
+			timed_out = 1;
+		}
+		// Wait for output, backing off exponentially, such that quick children
+		// are noticed quickly
+		struct pollfd poll_fd = { .fd = child->output_fd, .events = POLLIN };
+		struct timespec interval = { .tv_sec = 0, .tv_nsec = poll_interval };
+		ppoll(&poll_fd, 1, &interval, NULL);
+		poll_interval = poll_interval < 10000000 ? poll_interval * 2 : poll_interval;
+	}
+	watchdog.death_child = 0;
+	if(child_pid < 0) {
+		fprintf(stderr, _CTESTER_INDENT "%s:%d: Warning.\n" _CTESTER_INDENT "    Failed to create a child process: %s (%d)\n", file, line, strerror(errno), errno);
+		*status = 0;
+	}
+	child_read_output(child);
+	if(child->output_fd >= 0) {
+		close(child->output_fd);
+		child->output_fd = -1;
+	}
+
+	// See _ctester_child_started
+	if(child->use_vfork && options.timeout_ms && WIFSIGNALED(*status) && WTERMSIG(*status) == SIGALRM) {
+		timed_out = 1;
+	}
+
+	if(child->restore_sigchld) {
+		signal(SIGCHLD, SIG_IGN);
+	}
+	if(death_test_paused_timer.it_value.tv_sec || death_test_paused_timer.it_value.tv_nsec) {
+		timer_settime(watchdog.test_timer, 0, &death_test_paused_timer, NULL);
+	}
+
+	return timed_out ? -1 : 0;
+}
+
+int _ctester_child_output_matches(struct ctester_child_t *child, const char *regex, const char *file, int line) {
+	int matches = 1;
+	if(*regex) {
+		regex_t compiled;
+		int error = regcomp(&compiled, regex, REG_EXTENDED | REG_NOSUB);
+		if(error) {
+			char message[256];
+			regerror(error, &compiled, message, sizeof(message));
+			fprintf(stderr, _CTESTER_INDENT "%s:%d: Invalid regular expression \"%s\": %s\n", file, line, regex, message);
+			return 0;
+		}
+		matches = regexec(&compiled, child->output ? child->output : "", 0, NULL, 0) == 0;
+		regfree(&compiled);
+	}
+	if(matches) {
+		free(child->output);
+		child->output = NULL;
+		child->output_size = 0;
+	}
+	return matches;
+}
+
+void _ctester_child_print_output(struct ctester_child_t *child, FILE *output) {
+	if(child->output_size) {
+		fprintf(output, _CTESTER_INDENT "    Output on stderr:\n");
+		for(char *line = strtok(child->output, "\n"); line; line = strtok(NULL, "\n")) {
+			fprintf(output, _CTESTER_INDENT "        %s\n", line);
+		}
+	}
+	free(child->output);
+	child->output = NULL;
+	child->output_size = 0;
+}
+
+void _ctester_fatal_failure(struct ctester_test_case_state_t *ctester_state, int line) {
+	__atomic_store_n(&ctester_state->failed, line, __ATOMIC_RELAXED);
+	if(ctester_state->fatal_jump) {
+		longjmp(*ctester_state->fatal_jump, 1);
+	}
+}
+
+struct ctester_value_t _ctester_value_signed(long long value) {
+	return (struct ctester_value_t){ .kind = _CTESTER_VALUE_SIGNED, .integer = value };
+}
+
+struct ctester_value_t _ctester_value_unsigned(unsigned long long value) {
+	return (struct ctester_value_t){ .kind = _CTESTER_VALUE_UNSIGNED, .unsigned_integer = value };
+}
+
+struct ctester_value_t _ctester_value_float(float value) {
+	return (struct ctester_value_t){ .kind = _CTESTER_VALUE_FLOAT, .real = value };
+}
+
+struct ctester_value_t _ctester_value_double(double value) {
+	return (struct ctester_value_t){ .kind = _CTESTER_VALUE_DOUBLE, .real = value };
+}
+
+struct ctester_value_t _ctester_value_long_double(long double value) {
+	return (struct ctester_value_t){ .kind = _CTESTER_VALUE_LONG_DOUBLE, .real = value };
+}
+
+struct ctester_value_t _ctester_value_string(const void *value) {
+	return (struct ctester_value_t){ .kind = _CTESTER_VALUE_STRING, .pointer = value };
+}
+
+struct ctester_value_t _ctester_value_pointer(const void *value) {
+	return (struct ctester_value_t){ .kind = _CTESTER_VALUE_POINTER, .pointer = value };
+}
+
+// Strings longer than this, or with several lines, are shown as a diff when they differ
+#define _CTESTER_DIFF_THRESHOLD 80
+// Number of unchanged lines shown around each change of a line diff
+#define _CTESTER_DIFF_CONTEXT_LINES 3
+// Number of unchanged characters shown around each change of a character diff
+#define _CTESTER_DIFF_CONTEXT_CHARACTERS 20
+// Number of characters of a line, or of a changed part of a string, shown at most
+#define _CTESTER_DIFF_MAX_LINE_LENGTH 200
+// Number of characters of a diff shown at most, after which it is truncated
+#define _CTESTER_DIFF_MAX_OUTPUT 8192
+// Inputs larger than this are not diffed
+#define _CTESTER_DIFF_MAX_INPUT (64 << 20)
+// Number of comparisons a diff may take, roughly, before it gives up on finding a minimal one
+#define _CTESTER_DIFF_WORK (1L << 26)
+// Number of edits the diff searches at least before it gives up, no matter the size of the input
+#define _CTESTER_DIFF_MIN_COST 64
+
+/**
+ * A part of the first input of a diff that is replaced by a part of the
+ * second one. Either part may be empty.
+ */
+struct ctester_diff_change_t {
+	size_t a_start; //<<< First element of the first input that is removed
+	size_t a_end;   //<<< One past the last element of the first input that is removed
+	size_t b_start; //<<< First element of the second input that is inserted
+	size_t b_end;   //<<< One past the last element of the second input that is inserted
+};
+
+/**
+ * State of a diff of two strings, either by lines or by characters.
+ */
+struct ctester_diff_t {
+	const char *a;                          //<<< First input
+	const char *b;                          //<<< Second input
+	size_t *a_lines;                        //<<< Offsets of the lines of ::a, and of its end, or NULL to diff characters
+	size_t *b_lines;                        //<<< Offsets of the lines of ::b, and of its end
+	long max_cost;                          //<<< Number of edits after which a middle snake is not searched any further
+	long *forward;                          //<<< Furthest reaching paths of the forward search, by diagonal
+	long *backward;                         //<<< Furthest reaching paths of the backward search, by diagonal
+	struct ctester_diff_change_t *changes;  //<<< Changes found so far, in order
+	size_t number_of_changes;               //<<< Number of ::changes
+	size_t changes_size;                    //<<< Number of ::changes allocated
+};
+
+/**
+ * Characters of a diff that may still be printed, see
+ * `_CTESTER_DIFF_MAX_OUTPUT`.
+ */
+struct ctester_diff_output_t {
+	FILE *output;  //<<< Stream the diff is printed to
+	size_t budget; //<<< Number of characters that may still be printed
+};
+
+/**
+ * Return whether element `i` of the first input of `diff` equals element `j`
+ * of the second.
+ */
+static int diff_equal(const struct ctester_diff_t *diff, size_t i, size_t j) {
+	if(!diff->a_lines) {
+		return diff->a[i] == diff->b[j];
+	}
+	size_t a_length = diff->a_lines[i + 1] - diff->a_lines[i];
+	size_t b_length = diff->b_lines[j + 1] - diff->b_lines[j];
+	return a_length == b_length && !memcmp(diff->a + diff->a_lines[i], diff->b + diff->b_lines[j], a_length);
+}
+
+/**
+ * Append a change to `diff`, merging it with the previous one if they touch.
+ */
+static void diff_add_change(struct ctester_diff_t *diff, size_t a_start, size_t a_end, size_t b_start, size_t b_end) {
+	if(diff->number_of_changes) {
+		struct ctester_diff_change_t *last = &diff->changes[diff->number_of_changes - 1];
+		if(last->a_end == a_start && last->b_end == b_start) {
+			last->a_end = a_end;
+			last->b_end = b_end;
+			return;
+		}
+	}
+	if(diff->number_of_changes == diff->changes_size) {
+		diff->changes_size = diff->changes_size ? 2 * diff->changes_size : 16;
+		diff->changes = realloc(diff->changes, diff->changes_size * sizeof(struct ctester_diff_change_t));
+		if(!diff->changes) {
+			print_info(31, _CTESTER_INFO_FAILED, "Failed to allocate memory.\n");
+			exit(1);
+		}
+	}
+	diff->changes[diff->number_of_changes++] = (struct ctester_diff_change_t){ a_start, a_end, b_start, b_end };
+}
+
+/**
+ * Find the middle snake of an optimal path through the edit graph of the
+ * elements `[a_start, a_end)` and `[b_start, b_end)`, by searching forward
+ * from the start and backward from the end until the paths overlap, as
+ * described by Myers in "An O(ND) difference algorithm and its variations".
+ * Stores where the snake starts and ends. Returns the number of edits of the
+ * path, or -1 if it exceeds ::max_cost.
+ */
+static long diff_middle_snake(struct ctester_diff_t *diff, size_t a_start, size_t a_end, size_t b_start, size_t b_end,
+	size_t *x_start, size_t *y_start, size_t *x_end, size_t *y_end) {
+	long n = a_end - a_start;
+	long m = b_end - b_start;
+	long delta = n - m;
+	// Diagonal k is stored at forward[k + offset], and the backward search numbers diagonals from the end
+	long offset = diff->max_cost + 1;
+	long *forward = diff->forward + offset;
+	long *backward = diff->backward + offset;
+	forward[1] = 0;
+	backward[1] = 0;
+	for(long d = 0; d <= (n + m + 1) / 2 && d <= diff->max_cost; d++) {
+		for(long k = -d; k <= d; k += 2) {
+			long x = k == -d || (k != d && forward[k - 1] < forward[k + 1]) ? forward[k + 1] : forward[k - 1] + 1;
+			long y = x - k;
+			long snake_x = x, snake_y = y;
+			while(x < n && y < m && diff_equal(diff, a_start + x, b_start + y)) {
+				x++;
+				y++;
+			}
+			forward[k] = x;
+			if((delta & 1) && delta - k >= -(d - 1) && delta - k <= d - 1 && x + backward[delta - k] >= n) {
+				*x_start = a_start + snake_x;
+				*y_start = b_start + snake_y;
+				*x_end = a_start + x;
+				*y_end = b_start + y;
+				return 2 * d - 1;
+			}
+		}
+		for(long k = -d; k <= d; k += 2) {
+			long x = k == -d || (k != d && backward[k - 1] < backward[k + 1]) ? backward[k + 1] : backward[k - 1] + 1;
+			long y = x - k;
+			long snake_x = x, snake_y = y;
+			while(x < n && y < m && diff_equal(diff, a_end - x - 1, b_end - y - 1)) {
+				x++;
+				y++;
+			}
+			backward[k] = x;
+			if(!(delta & 1) && delta - k >= -d && delta - k <= d && x + forward[delta - k] >= n) {
+				*x_start = a_end - x;
+				*y_start = b_end - y;
+				*x_end = a_end - snake_x;
+				*y_end = b_end - snake_y;
+				return 2 * d;
+			}
+		}
+	}
+	return -1;
+}
+
+/**
+ * Record the changes between the elements `[a_start, a_end)` and
+ * `[b_start, b_end)`. Parts whose minimal diff is too expensive to find are
+ * recorded as replaced as a whole.
+ */
+static void diff_compare(struct ctester_diff_t *diff, size_t a_start, size_t a_end, size_t b_start, size_t b_end) {
+	while(a_start < a_end && b_start < b_end && diff_equal(diff, a_start, b_start)) {
+		a_start++;
+		b_start++;
+	}
+	while(a_start < a_end && b_start < b_end && diff_equal(diff, a_end - 1, b_end - 1)) {
+		a_end--;
+		b_end--;
+	}
+	if(a_start == a_end || b_start == b_end) {
+		if(a_start != a_end || b_start != b_end) {
+			diff_add_change(diff, a_start, a_end, b_start, b_end);
+		}
+		return;
+	}
+	size_t x_start, y_start, x_end, y_end;
+	if(diff_middle_snake(diff, a_start, a_end, b_start, b_end, &x_start, &y_start, &x_end, &y_end) < 0) {
+		diff_add_change(diff, a_start, a_end, b_start, b_end);
+		return;
+	}
+	diff_compare(diff, a_start, x_start, b_start, y_start);
+	diff_compare(diff, x_end, a_end, y_end, b_end);
+}
+
+/**
+ * Split `text` into lines. Returns a newly allocated array with the offsets
+ * of the lines, followed by `size`, and stores the number of lines.
+ */
+static size_t *diff_split_lines(const char *text, size_t size, size_t *number_of_lines) {
+	size_t count = size && text[size - 1] != '\n' ? 1 : 0;
+	for(const char *newline = text; size && (newline = memchr(newline, '\n', text + size - newline)); newline++) {
+		count++;
+	}
+	size_t *lines = malloc((count + 1) * sizeof(size_t));
+	if(!lines) {
+		print_info(31, _CTESTER_INFO_FAILED, "Failed to allocate memory.\n");
+		exit(1);
+	}
+	size_t line = 0;
+	lines[line++] = 0;
+	for(size_t i = 0; i + 1 < size; i++) {
+		if(text[i] == '\n') {
+			lines[line++] = i + 1;
+		}
+	}
+	lines[count] = size;
+	*number_of_lines = count;
+	return lines;
+}
+
+/**
+ * Charge `printed` characters, as returned by fprintf(3), against the budget
+ * of `output`. Returns 0 if the budget ran out.
+ */
+static int diff_spend(struct ctester_diff_output_t *output, int printed) {
+	output->budget -= printed > 0 && (size_t)printed < output->budget ? (size_t)printed : output->budget;
+	return output->budget > 0;
+}
+
+/**
+ * Print up to `_CTESTER_DIFF_MAX_LINE_LENGTH` characters of `text`, with
+ * control characters escaped, and a marker if it is longer. Tabs are kept
+ * unless `escape_tabs` is set. Returns 0 if the budget of `output` ran out.
+ */
+static int diff_print(struct ctester_diff_output_t *output, const char *text, size_t length, int escape_tabs) {
+	size_t shown = length < _CTESTER_DIFF_MAX_LINE_LENGTH ? length : _CTESTER_DIFF_MAX_LINE_LENGTH;
+	size_t i;
+	for(i = 0; i < shown && output->budget; i++) {
+		unsigned char character = text[i];
+		if(character == '\n') {
+			diff_spend(output, fprintf(output->output, "\\n"));
+		}
+		else if(character == '\t' && escape_tabs) {
+			diff_spend(output, fprintf(output->output, "\\t"));
+		}
+		else if((character < ' ' && character != '\t') || character == 0x7f) {
+			diff_spend(output, fprintf(output->output, "\\x%02x", character));
+		}
+		else {
+			fputc(character, output->output);
+			diff_spend(output, 1);
+		}
+	}
+	if(i < length && output->budget) {
+		diff_spend(output, fprintf(output->output, "[... %zu more characters]", length - i));
+	}
+	return output->budget > 0;
+}
+
+/**
+ * Print one line of a line diff, prefixed by `prefix`. The prefix and the
+ * newline count against the budget too, such that empty lines are not free.
+ */
+static int diff_print_line(struct ctester_diff_output_t *output, char prefix, const char *text, const size_t *lines, size_t line) {
+	size_t start = lines[line];
+	size_t end = lines[line + 1];
+	if(end > start && text[end - 1] == '\n') {
+		end--;
+	}
+	if(diff_spend(output, fprintf(output->output, _CTESTER_INDENT "    %c", prefix))) {
+		diff_print(output, text + start, end - start, 0);
+	}
+	fputc('\n', output->output);
+	return diff_spend(output, 1);
+}
+
+/**
+ * Print the changes of `diff` as hunks with `context` unchanged elements
+ * around each. Line diffs use the unified format, and character diffs show
+ * each hunk on one line, marking removed parts as `[-...-]` and inserted
+ * ones as `{+...+}`. Everything printed counts against the budget of
+ * `output`, including hunk headers and markers.
+ */
+static void diff_print_hunks(struct ctester_diff_t *diff, struct ctester_diff_output_t *output, size_t a_count, size_t context) {
+	int remaining = 1;
+	for(size_t first = 0; first < diff->number_of_changes && remaining; ) {
+		size_t last = first;
+		while(last + 1 < diff->number_of_changes && diff->changes[last + 1].a_start - diff->changes[last].a_end <= 2 * context) {
+			last++;
+		}
+		const struct ctester_diff_change_t *start = &diff->changes[first];
+		const struct ctester_diff_change_t *end = &diff->changes[last];
+		size_t a_start = start->a_start > context ? start->a_start - context : 0;
+		size_t a_end = end->a_end + context < a_count ? end->a_end + context : a_count;
+		size_t b_start = start->b_start - (start->a_start - a_start);
+		size_t b_end = end->b_end + (a_end - end->a_end);
+		if(diff->a_lines) {
+			remaining = diff_spend(output, fprintf(output->output, _CTESTER_INDENT "    @@ -%zu,%zu +%zu,%zu @@\n",
+				a_start + 1, a_end - a_start, b_start + 1, b_end - b_start));
+			size_t position = a_start;
+			for(size_t i = first; i <= last && remaining; i++) {
+				const struct ctester_diff_change_t *change = &diff->changes[i];
+				for(; position < change->a_start && remaining; position++) {
+					remaining = diff_print_line(output, ' ', diff->a, diff->a_lines, position);
+				}
+				for(size_t line = change->a_start; line < change->a_end && remaining; line++) {
+					remaining = diff_print_line(output, '-', diff->a, diff->a_lines, line);
+				}
+				for(size_t line = change->b_start; line < change->b_end && remaining; line++) {
+					remaining = diff_print_line(output, '+', diff->b, diff->b_lines, line);
+				}
+				position = change->a_end;
+			}
+			for(; position < a_end && remaining; position++) {
+				remaining = diff_print_line(output, ' ', diff->a, diff->a_lines, position);
+			}
+		}
+		else {
+			remaining = diff_spend(output, fprintf(output->output, _CTESTER_INDENT "    @@ -%zu +%zu @@ %s", a_start, b_start, a_start ? "..." : ""));
+			size_t position = a_start;
+			for(size_t i = first; i <= last && remaining; i++) {
+				const struct ctester_diff_change_t *change = &diff->changes[i];
+				remaining = diff_print(output, diff->a + position, change->a_start - position, 1);
+				if(remaining && change->a_end > change->a_start) {
+					remaining = diff_spend(output, fprintf(output->output, "[-")) &&
+						diff_print(output, diff->a + change->a_start, change->a_end - change->a_start, 1);
+					diff_spend(output, fprintf(output->output, "-]"));
+				}
+				if(remaining && change->b_end > change->b_start) {
+					remaining = diff_spend(output, fprintf(output->output, "{+")) &&
+						diff_print(output, diff->b + change->b_start, change->b_end - change->b_start, 1);
+					diff_spend(output, fprintf(output->output, "+}"));
+				}
+				position = change->a_end;
+			}
+			if(remaining) {
+				remaining = diff_print(output, diff->a + position, a_end - position, 1);
+			}
+			diff_spend(output, fprintf(output->output, "%s\n", a_end < a_count ? "..." : ""));
+			remaining = remaining && output->budget > 0;
+		}
+		first = last + 1;
+	}
+	if(!remaining) {
+		fprintf(output->output, _CTESTER_INDENT "    [... diff truncated after %d characters]\n", _CTESTER_DIFF_MAX_OUTPUT);
+	}
+}
+
+/**
+ * Print a diff of the `a_size` bytes at `a` to the `b_size` bytes at `b`,
+ * named `a_name` and `b_name`. Inputs with several lines are diffed by
+ * lines, others by characters. Neither may exceed `_CTESTER_DIFF_MAX_INPUT`.
+ */
+static void print_diff(FILE *output, const char *a, size_t a_size, const char *b, size_t b_size, const char *a_name, const char *b_name) {
+	struct ctester_diff_t diff = { .a = a, .b = b };
+	size_t a_count = a_size, b_count = b_size;
+	if((a_size && memchr(a, '\n', a_size)) || (b_size && memchr(b, '\n', b_size))) {
+		diff.a_lines = diff_split_lines(a, a_size, &a_count);
+		diff.b_lines = diff_split_lines(b, b_size, &b_count);
+	}
+	long total = a_count + b_count + 1;
+	diff.max_cost = _CTESTER_DIFF_WORK / total;
+	if(diff.max_cost < _CTESTER_DIFF_MIN_COST) {
+		diff.max_cost = _CTESTER_DIFF_MIN_COST;
+	}
+	if(diff.max_cost > total / 2 + 1) {
+		diff.max_cost = total / 2 + 1;
+	}
+	diff.forward = malloc((2 * diff.max_cost + 3) * sizeof(long));
+	diff.backward = malloc((2 * diff.max_cost + 3) * sizeof(long));
+	if(!diff.forward || !diff.backward) {
+		print_info(31, _CTESTER_INFO_FAILED, "Failed to allocate memory.\n");
+		exit(1);
+	}
+	diff_compare(&diff, 0, a_count, 0, b_count);
+
+	fprintf(output, _CTESTER_INDENT "    --- %s\n" _CTESTER_INDENT "    +++ %s\n", a_name, b_name);
+	struct ctester_diff_output_t diff_output = { .output = output, .budget = _CTESTER_DIFF_MAX_OUTPUT };
+	diff_print_hunks(&diff, &diff_output, a_count, diff.a_lines ? _CTESTER_DIFF_CONTEXT_LINES : _CTESTER_DIFF_CONTEXT_CHARACTERS);
+
+	free(diff.a_lines);
+	free(diff.b_lines);
+	free(diff.forward);
+	free(diff.backward);
+	free(diff.changes);
+}
+
+/**
+ * Print a value compared by an assertion in the format of its type.
+ */
+static void print_value(FILE *output, struct ctester_value_t value) {
+	switch(value.kind) {
+		case _CTESTER_VALUE_SIGNED:
+			fprintf(output, "%lld", value.integer);
+			break;
+		case _CTESTER_VALUE_UNSIGNED:
+			fprintf(output, "%llu", value.unsigned_integer);
+			break;
+		case _CTESTER_VALUE_FLOAT:
+			fprintf(output, "%f", (double)value.real);
+			break;
+		case _CTESTER_VALUE_DOUBLE:
+			fprintf(output, "%g", (double)value.real);
+			break;
+		case _CTESTER_VALUE_LONG_DOUBLE:
+			fprintf(output, "%Lg", value.real);
+			break;
+		case _CTESTER_VALUE_STRING:
+			if(value.pointer && strlen(value.pointer) > _CTESTER_DIFF_MAX_LINE_LENGTH) {
+				fprintf(output, "%.*s[... %zu more characters]", _CTESTER_DIFF_MAX_LINE_LENGTH, (const char *)value.pointer,
+					strlen(value.pointer) - _CTESTER_DIFF_MAX_LINE_LENGTH);
+			}
+			else {
+				fprintf(output, "%s", (const char *)value.pointer);
+			}
+			break;
+		default:
+			fprintf(output, "%p", value.pointer);
+			break;
+	}
+}
+
+/**
+ * Record a failure reported by ::_ctester_report_comparison or
+ * ::_ctester_report_predicate.
+ */
+static void record_failure(struct ctester_test_case_state_t *ctester_state, int fatal, int line) {
+	if(fatal) {
+		_ctester_fatal_failure(ctester_state, line);
+	}
+	else {
+		__atomic_add_fetch(&ctester_state->warning, 1, __ATOMIC_RELAXED);
+	}
+}
+
+void _ctester_report_comparison(struct ctester_test_case_state_t *ctester_state, int fatal, const char *file, int line, const char *expression,
+	const char *a, struct ctester_value_t a_value, const char *b, struct ctester_value_t b_value, int has_message, const char *message_format, ...) {
+	// Other threads of the test may report failures at the same time
+	FILE *output = _CTESTER_OUTPUT;
+	flockfile(output);
+	fprintf(output, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s but\n", file, line, expression);
+	const char *a_string = a_value.pointer;
+	const char *b_string = b_value.pointer;
+	size_t a_length = a_value.kind == _CTESTER_VALUE_STRING && a_string ? strlen(a_string) : 0;
+	size_t b_length = b_value.kind == _CTESTER_VALUE_STRING && b_string ? strlen(b_string) : 0;
+	int show_diff = a_value.kind == _CTESTER_VALUE_STRING && b_value.kind == _CTESTER_VALUE_STRING && a_string && b_string &&
+		strcmp(a_string, b_string) && a_length <= _CTESTER_DIFF_MAX_INPUT && b_length <= _CTESTER_DIFF_MAX_INPUT &&
+		(a_length > _CTESTER_DIFF_THRESHOLD || b_length > _CTESTER_DIFF_THRESHOLD || strchr(a_string, '\n') || strchr(b_string, '\n'));
+	if(show_diff) {
+		fprintf(output, _CTESTER_INDENT "    %s and %s differ", a, b);
+	}
+	else {
+		fprintf(output, _CTESTER_INDENT "    %s == ", a);
+		print_value(output, a_value);
+		fprintf(output, ",\n" _CTESTER_INDENT "    %s == ", b);
+		print_value(output, b_value);
+	}
+	if(has_message) {
+		va_list arguments;
+		va_start(arguments, message_format);
+		vfprintf(output, message_format, arguments);
+		va_end(arguments);
+	}
+	fprintf(output, show_diff ? ":\n" : "\n");
+	if(show_diff) {
+		print_diff(output, a_string, a_length, b_string, b_length, a, b);
+	}
+	funlockfile(output);
+	record_failure(ctester_state, fatal, line);
+}
+
+void _ctester_report_predicate(struct ctester_test_case_state_t *ctester_state, int fatal, const char *function, const char *file, int line, const char *expression,
+	const char *a, struct ctester_value_t a_value, int has_message, const char *message_format, ...) {
+	FILE *output = _CTESTER_OUTPUT;
+	flockfile(output);
+	fprintf(output, _CTESTER_INDENT "%s (%s:%d): Failure.\n" _CTESTER_INDENT "    Expected: %s but\n" _CTESTER_INDENT "    %s == ", function, file, line, expression, a);
+	print_value(output, a_value);
+	if(has_message) {
+		va_list arguments;
+		va_start(arguments, message_format);
+		vfprintf(output, message_format, arguments);
+		va_end(arguments);
+	}
+	fprintf(output, "\n");
+	funlockfile(output);
+	record_failure(ctester_state, fatal, line);
+}
+
+// Number of elements shown before and after the first mismatch of a bulk assertion
+#define _CTESTER_ARRAY_CONTEXT 3
+// Number of bytes per line in the hexdump of a failed ::ASSERT_MEMEQ
+#define _CTESTER_HEXDUMP_WIDTH 16
+
+/*
+ * Kernels of the bulk assertions. Each returns the index of the first
+ * candidate for a mismatch at or after `start`, or where it stopped because
+ * too few elements were left for a full vector. Candidates are rechecked by
+ * element_matches(), so the vector kernels only need to be exact for the
+ * elements they skip.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+static size_t first_difference_avx2(const unsigned char *a, const unsigned char *b, size_t start, size_t size) {
+	size_t offset = start;
+	for(; offset + 32 <= size; offset += 32) {
+		__m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + offset)), _mm256_loadu_si256((const __m256i *)(b + offset)));
+		unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(equal);
+		if(mask) {
+			return offset + __builtin_ctz(mask);
+		}
+	}
+	return offset;
+}
+
+__attribute__((target("avx2")))
+static size_t first_far_float_avx2(const float *a, const float *b, size_t start, size_t count, float tolerance) {
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	const __m256 limit = _mm256_set1_ps(tolerance);
+	size_t index = start;
+	for(; index + 8 <= count; index += 8) {
+		__m256 difference = _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_loadu_ps(a + index), _mm256_loadu_ps(b + index)));
+		unsigned int mask = ~(unsigned int)_mm256_movemask_ps(_mm256_cmp_ps(difference, limit, _CMP_LE_OQ)) & 0xFF;
+		if(mask) {
+			return index + __builtin_ctz(mask);
+		}
+	}
+	return index;
+}
+
+__attribute__((target("avx2")))
+static size_t first_far_double_avx2(const double *a, const double *b, size_t start, size_t count, double tolerance) {
+	const __m256d sign = _mm256_set1_pd(-0.0);
+	const __m256d limit = _mm256_set1_pd(tolerance);
+	size_t index = start;
+	for(; index + 4 <= count; index += 4) {
+		__m256d difference = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(a + index), _mm256_loadu_pd(b + index)));
+		unsigned int mask = ~(unsigned int)_mm256_movemask_pd(_mm256_cmp_pd(difference, limit, _CMP_LE_OQ)) & 0xF;
+		if(mask) {
+			return index + __builtin_ctz(mask);
+		}
+	}
+	return index;
+}
+#endif
+
+#if defined(__SSE2__)
+static size_t first_difference_sse2(const unsigned char *a, const unsigned char *b, size_t start, size_t size) {
+	size_t offset = start;
+	for(; offset + 16 <= size; offset += 16) {
+		__m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + offset)), _mm_loadu_si128((const __m128i *)(b + offset)));
+		unsigned int mask = ~(unsigned int)_mm_movemask_epi8(equal) & 0xFFFF;
+		if(mask) {
+			return offset + __builtin_ctz(mask);
+		}
+	}
+	return offset;
+}
+
+static size_t first_far_float_sse2(const float *a, const float *b, size_t start, size_t count, float tolerance) {
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 limit = _mm_set1_ps(tolerance);
+	size_t index = start;
+	for(; index + 4 <= count; index += 4) {
+		__m128 difference = _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(a + index), _mm_loadu_ps(b + index)));
+		unsigned int mask = ~(unsigned int)_mm_movemask_ps(_mm_cmple_ps(difference, limit)) & 0xF;
+		if(mask) {
+			return index + __builtin_ctz(mask);
+		}
+	}
+	return index;
+}
+
+static size_t first_far_double_sse2(const double *a, const double *b, size_t start, size_t count, double tolerance) {
+	const __m128d sign = _mm_set1_pd(-0.0);
+	const __m128d limit = _mm_set1_pd(tolerance);
+	size_t index = start;
+	for(; index + 2 <= count; index += 2) {
+		__m128d difference = _mm_andnot_pd(sign, _mm_sub_pd(_mm_loadu_pd(a + index), _mm_loadu_pd(b + index)));
+		unsigned int mask = ~(unsigned int)_mm_movemask_pd(_mm_cmple_pd(difference, limit)) & 0x3;
+		if(mask) {
+			return index + __builtin_ctz(mask);
+		}
+	}
+	return index;
+}
+#endif
+
+#if defined(__aarch64__)
+static size_t first_difference_neon(const unsigned char *a, const unsigned char *b, size_t start, size_t size) {
+	size_t offset = start;
+	for(; offset + 16 <= size; offset += 16) {
+		if(vminvq_u8(vceqq_u8(vld1q_u8(a + offset), vld1q_u8(b + offset))) != 0xFF) {
+			return offset;
+		}
+	}
+	return offset;
+}
+
+static size_t first_far_float_neon(const float *a, const float *b, size_t start, size_t count, float tolerance) {
+	const float32x4_t limit = vdupq_n_f32(tolerance);
+	size_t index = start;
+	for(; index + 4 <= count; index += 4) {
+		if(vminvq_u32(vcleq_f32(vabdq_f32(vld1q_f32(a + index), vld1q_f32(b + index)), limit)) != 0xFFFFFFFF) {
+			return index;
+		}
+	}
+	return index;
+}
+
+static size_t first_far_double_neon(const double *a, const double *b, size_t start, size_t count, double tolerance) {
+	const float64x2_t limit = vdupq_n_f64(tolerance);
+	size_t index = start;
+	for(; index + 2 <= count; index += 2) {
+		uint64x2_t near = vcleq_f64(vabdq_f64(vld1q_f64(a + index), vld1q_f64(b + index)), limit);
+		if(!vgetq_lane_u64(near, 0) || !vgetq_lane_u64(near, 1)) {
+			return index;
+		}
+	}
+	return index;
+}
+#endif
+
+/**
+ * Return the offset of the first byte at or after `start` that differs
+ * between `a` and `b`, or `size`.
+ */
+static size_t first_difference(const unsigned char *a, const unsigned char *b, size_t start, size_t size) {
+	size_t offset = start;
+#if defined(__x86_64__) || defined(__i386__)
+	if(__builtin_cpu_supports("avx2")) {
+		offset = first_difference_avx2(a, b, offset, size);
+	}
+#endif
+#if defined(__SSE2__)
+	offset = first_difference_sse2(a, b, offset, size);
+#elif defined(__aarch64__)
+	offset = first_difference_neon(a, b, offset, size);
+#endif
+	while(offset < size && a[offset] == b[offset]) {
+		offset++;
+	}
+	return offset;
+}
+
+/**
+ * Return the index of the first float at or after `start` whose difference
+ * exceeds `tolerance`, or `count`.
+ */
+static size_t first_far_float(const float *a, const float *b, size_t start, size_t count, float tolerance) {
+	size_t index = start;
+#if defined(__x86_64__) || defined(__i386__)
+	if(__builtin_cpu_supports("avx2")) {
+		index = first_far_float_avx2(a, b, index, count, tolerance);
+	}
+#endif
+#if defined(__SSE2__)
+	index = first_far_float_sse2(a, b, index, count, tolerance);
+#elif defined(__aarch64__)
+	index = first_far_float_neon(a, b, index, count, tolerance);
+#endif
+	while(index < count && fabsf(a[index] - b[index]) <= tolerance) {
+		index++;
+	}
+	return index;
+}
+
+/**
+ * Return the index of the first double at or after `start` whose difference
+ * exceeds `tolerance`, or `count`.
+ */
+static size_t first_far_double(const double *a, const double *b, size_t start, size_t count, double tolerance) {
+	size_t index = start;
+#if defined(__x86_64__) || defined(__i386__)
+	if(__builtin_cpu_supports("avx2")) {
+		index = first_far_double_avx2(a, b, index, count, tolerance);
+	}
+#endif
+#if defined(__SSE2__)
+	index = first_far_double_sse2(a, b, index, count, tolerance);
+#elif defined(__aarch64__)
+	index = first_far_double_neon(a, b, index, count, tolerance);
+#endif
+	while(index < count && fabs(a[index] - b[index]) <= tolerance) {
+		index++;
+	}
+	return index;
+}
+
+/**
+ * Map the bits of a floating point number to an integer that increases by
+ * one from each representable number to the next, with both zeros at the
+ * same place. `sign` is the sign bit, which is also the highest bit of the
+ * number, such that floats stay within 32 bits.
+ */
+static uint64_t ordered_bits(uint64_t bits, uint64_t sign) {
+	return (bits & sign ? ~bits + 1 : bits | sign) & (sign | (sign - 1));
+}
+
+/**
+ * Return whether element `index` of both buffers matches under the
+ * comparison of the assertion.
+ */
+static int element_matches(const struct ctester_array_t *array, size_t index) {
+	const unsigned char *a = (const unsigned char *)array->a + index * array->element_size;
+	const unsigned char *b = (const unsigned char *)array->b + index * array->element_size;
+	if(array->comparison == _CTESTER_COMPARE_BYTES) {
+		return !memcmp(a, b, array->element_size);
+	}
+	double a_value, b_value;
+	uint64_t a_bits, b_bits, sign;
+	if(array->kind == _CTESTER_VALUE_FLOAT) {
+		float a_float, b_float;
+		uint32_t a_float_bits, b_float_bits;
+		memcpy(&a_float, a, sizeof(float));
+		memcpy(&b_float, b, sizeof(float));
+		memcpy(&a_float_bits, a, sizeof(float));
+		memcpy(&b_float_bits, b, sizeof(float));
+		if(array->comparison == _CTESTER_COMPARE_ABSOLUTE && fabsf(a_float - b_float) <= (float)array->tolerance) {
+			return 1;
+		}
+		a_value = a_float;
+		b_value = b_float;
+		a_bits = a_float_bits;
+		b_bits = b_float_bits;
+		sign = 1ull << 31;
+	}
+	else {
+		memcpy(&a_value, a, sizeof(double));
+		memcpy(&b_value, b, sizeof(double));
+		memcpy(&a_bits, a, sizeof(double));
+		memcpy(&b_bits, b, sizeof(double));
+		if(array->comparison == _CTESTER_COMPARE_ABSOLUTE && fabs(a_value - b_value) <= array->tolerance) {
+			return 1;
+		}
+		sign = 1ull << 63;
+	}
+	if(isnan(a_value) || isnan(b_value)) {
+		return isnan(a_value) && isnan(b_value);
+	}
+	if(a_value == b_value) {
+		return 1;
+	}
+	if(array->comparison == _CTESTER_COMPARE_ABSOLUTE) {
+		return 0;
+	}
+	uint64_t a_ordered = ordered_bits(a_bits, sign);
+	uint64_t b_ordered = ordered_bits(b_bits, sign);
+	return (a_ordered > b_ordered ? a_ordered - b_ordered : b_ordered - a_ordered) <= array->ulps;
+}
+
+size_t _ctester_array_mismatch(const struct ctester_array_t *array, size_t start) {
+	for(size_t index = start; index < array->count; index++) {
+		if(array->comparison == _CTESTER_COMPARE_ABSOLUTE && array->kind == _CTESTER_VALUE_FLOAT) {
+			index = first_far_float(array->a, array->b, index, array->count, (float)array->tolerance);
+		}
+		else if(array->comparison == _CTESTER_COMPARE_ABSOLUTE) {
+			index = first_far_double(array->a, array->b, index, array->count, array->tolerance);
+		}
+		else {
+			// Elements with equal bytes match under any comparison
+			index = first_difference(array->a, array->b, index * array->element_size, array->count * array->element_size) / array->element_size;
+		}
+		if(index >= array->count || !element_matches(array, index)) {
+			return index;
+		}
+	}
+	return array->count;
+}
+
+/**
+ * Print element `index` of one of the buffers of a bulk assertion.
+ */
+static void print_element(FILE *output, const struct ctester_array_t *array, const void *buffer, size_t index) {
+	const unsigned char *element = (const unsigned char *)buffer + index * array->element_size;
+	struct ctester_value_t value = { .kind = array->kind };
+	if(array->kind == _CTESTER_VALUE_SIGNED) {
+		if(array->element_size == 1) {
+			value.integer = *(const int8_t *)element;
+		}
+		else if(array->element_size == 2) {
+			value.integer = *(const int16_t *)element;
+		}
+		else if(array->element_size == 4) {
+			value.integer = *(const int32_t *)element;
+		}
+		else {
+			value.integer = *(const int64_t *)element;
+		}
+	}
+	else if(array->kind == _CTESTER_VALUE_UNSIGNED) {
+		if(array->element_size == 1) {
+			value.unsigned_integer = *(const uint8_t *)element;
+		}
+		else if(array->element_size == 2) {
+			value.unsigned_integer = *(const uint16_t *)element;
+		}
+		else if(array->element_size == 4) {
+			value.unsigned_integer = *(const uint32_t *)element;
+		}
+		else {
+			value.unsigned_integer = *(const uint64_t *)element;
+		}
+	}
+	else if(array->kind == _CTESTER_VALUE_FLOAT) {
+		value.real = *(const float *)element;
+	}
+	else if(array->kind == _CTESTER_VALUE_DOUBLE) {
+		value.real = *(const double *)element;
+	}
+	else if(array->kind == _CTESTER_VALUE_LONG_DOUBLE) {
+		value.real = *(const long double *)element;
+	}
+	else {
+		for(size_t i = 0; i < array->element_size; i++) {
+			fprintf(output, "%s%02x", i ? " " : "", element[i]);
+		}
+		return;
+	}
+	print_value(output, value);
+}
+
+/**
+ * Print the lines of the hexdump of a failed ::ASSERT_MEMEQ that show the
+ * bytes of both buffers around `first`, and mark the bytes that differ.
+ */
+static void print_hexdump(FILE *output, const struct ctester_array_t *array, const char *a, const char *b, size_t first) {
+	const unsigned char *a_bytes = array->a;
+	const unsigned char *b_bytes = array->b;
+	int label_width = (int)(strlen(a) > strlen(b) ? strlen(a) : strlen(b));
+	size_t line_start = first / _CTESTER_HEXDUMP_WIDTH * _CTESTER_HEXDUMP_WIDTH;
+	size_t start = line_start >= _CTESTER_HEXDUMP_WIDTH ? line_start - _CTESTER_HEXDUMP_WIDTH : 0;
+	size_t stop = line_start + 2 * _CTESTER_HEXDUMP_WIDTH < array->count ? line_start + 2 * _CTESTER_HEXDUMP_WIDTH : array->count;
+	int offset_width = snprintf(NULL, 0, "%zx", stop - 1);
+	if(offset_width < 4) {
+		offset_width = 4;
+	}
+	for(size_t line = start; line < stop; line += _CTESTER_HEXDUMP_WIDTH) {
+		size_t line_stop = line + _CTESTER_HEXDUMP_WIDTH < stop ? line + _CTESTER_HEXDUMP_WIDTH : stop;
+		for(int buffer = 0; buffer < 2; buffer++) {
+			fprintf(output, _CTESTER_INDENT "    %*s + 0x%0*zx:", label_width, buffer ? b : a, offset_width, line);
+			for(size_t i = line; i < line_stop; i++) {
+				fprintf(output, " %02x", (buffer ? b_bytes : a_bytes)[i]);
+			}
+			fprintf(output, "\n");
+		}
+		size_t marks_stop = line_stop;
+		while(marks_stop > line && a_bytes[marks_stop - 1] == b_bytes[marks_stop - 1]) {
+			marks_stop--;
+		}
+		if(marks_stop > line) {
+			// Align the marks with the bytes above, past "<label> + 0x<offset>:"
+			fprintf(output, _CTESTER_INDENT "    %*s", label_width + offset_width + 6, "");
+			for(size_t i = line; i < marks_stop; i++) {
+				fprintf(output, a_bytes[i] != b_bytes[i] ? " ^^" : "   ");
+			}
+			fprintf(output, "\n");
+		}
+	}
+}
+
+void _ctester_report_array(struct ctester_test_case_state_t *ctester_state, int fatal, const char *file, int line, const char *expression,
+	const char *a, const char *b, const struct ctester_array_t *array, size_t first, int has_message, const char *message_format, ...) {
+	size_t mismatches = 0;
+	for(size_t index = first; index < array->count; index = _ctester_array_mismatch(array, index + 1)) {
+		mismatches++;
+	}
+	const char *unit = array->kind == _CTESTER_VALUE_MEMORY && array->element_size == 1 ? "bytes" : "elements";
+
+	FILE *output = _CTESTER_OUTPUT;
+	flockfile(output);
+	fprintf(output, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s but\n" _CTESTER_INDENT "    %zu of %zu %s differ, the first at index %zu",
+		file, line, expression, mismatches, array->count, unit, first);
+	if(has_message) {
+		va_list arguments;
+		va_start(arguments, message_format);
+		vfprintf(output, message_format, arguments);
+		va_end(arguments);
+	}
+	fprintf(output, ":\n");
+	if(array->kind == _CTESTER_VALUE_MEMORY && array->element_size == 1) {
+		print_hexdump(output, array, a, b, first);
+	}
+	else {
+		size_t start = first > _CTESTER_ARRAY_CONTEXT ? first - _CTESTER_ARRAY_CONTEXT : 0;
+		size_t stop = first + _CTESTER_ARRAY_CONTEXT + 1 < array->count ? first + _CTESTER_ARRAY_CONTEXT + 1 : array->count;
+		for(size_t index = start; index < stop; index++) {
+			fprintf(output, _CTESTER_INDENT "  %s %s[%zu] == ", element_matches(array, index) ? " " : ">", a, index);
+			print_element(output, array, array->a, index);
+			fprintf(output, ", %s[%zu] == ", b, index);
+			print_element(output, array, array->b, index);
+			fprintf(output, "\n");
+		}
+	}
+	funlockfile(output);
+	record_failure(ctester_state, fatal, line);
+}
+
+/**
+ * Resolve the path of a golden file against the directory of the source
+ * file `file` of the test. Returns a newly allocated string.
+ */
+static char *golden_path(const char *file, const char *path) {
+	const char *slash = strrchr(file, '/');
+	char *resolved;
+	if(path[0] == '/' || !slash) {
+		resolved = strdup(path);
+	}
+	else if(asprintf(&resolved, "%.*s/%s", (int)(slash - file), file, path) < 0) {
+		resolved = NULL;
+	}
+	if(!resolved) {
+		print_info(31, _CTESTER_INFO_FAILED, "Failed to allocate memory.\n");
+		exit(1);
+	}
+	return resolved;
+}
+
+/**
+ * Replace the golden file at `path` by `size` bytes at `buffer`, such that
+ * it never has partial contents: they go to a temporary file that is then
+ * renamed. `mode` is given to the new file. Returns 0 on success and an
+ * errno(3) value otherwise.
+ */
+static int write_golden_file(const char *path, const void *buffer, size_t size, mode_t mode) {
+	char *temporary_path;
+	if(asprintf(&temporary_path, "%s.XXXXXX", path) < 0) {
+		return ENOMEM;
+	}
+	int fd = mkostemp(temporary_path, O_CLOEXEC);
+	if(fd < 0) {
+		int error = errno;
+		free(temporary_path);
+		return error;
+	}
+	int error = 0;
+	for(size_t written = 0; written < size && !error; ) {
+		ssize_t result = write(fd, (const char *)buffer + written, size - written);
+		if(result < 0 && errno != EINTR) {
+			error = errno;
+		}
+		else if(result > 0) {
+			written += result;
+		}
+	}
+	if(!error && (fchmod(fd, mode) < 0 || fsync(fd) < 0)) {
+		error = errno;
+	}
+	if(close(fd) < 0 && !error) {
+		error = errno;
+	}
+	if(!error && rename(temporary_path, path) < 0) {
+		error = errno;
+	}
+	if(error) {
+		unlink(temporary_path);
+	}
+	free(temporary_path);
+	return error;
+}
+
+int _ctester_golden_matches(struct ctester_test_case_state_t *ctester_state, int fatal, const char *file, int line, const char *buffer_text,
+	const void *buffer, size_t size, const char *path, int has_message, const char *message_format, ...) {
+	char *resolved_path = golden_path(file, path);
+	struct stat golden_stat;
+	const unsigned char *golden = NULL;
+	size_t golden_size = 0;
+	int error = 0;
+	int fd = open(resolved_path, O_RDONLY | O_CLOEXEC);
+	if(fd < 0 || fstat(fd, &golden_stat) < 0) {
+		error = errno;
+	}
+	else if(!S_ISREG(golden_stat.st_mode)) {
+		error = EINVAL;
+	}
+	else if((golden_size = golden_stat.st_size) > 0) {
+		golden = mmap(NULL, golden_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(golden == MAP_FAILED) {
+			error = errno;
+			golden = NULL;
+		}
+		else {
+			madvise((void *)golden, golden_size, MADV_SEQUENTIAL);
+		}
+	}
+
+	size_t common_size = size < golden_size ? size : golden_size;
+	size_t first = 0;
+	int matches = 0;
+	if(!error) {
+		first = common_size ? first_difference(buffer, golden, 0, common_size) : 0;
+		matches = first == common_size && size == golden_size;
+	}
+
+	FILE *output = _CTESTER_OUTPUT;
+	// Statements of meta-assertions are expected to fail, and must not replace references
+	if(!matches && options.update_golden && !ctester_state->fatal_jump) {
+		int write_error = write_golden_file(resolved_path, buffer, size, error ? 0644 : golden_stat.st_mode & 07777);
+		flockfile(output);
+		if(!write_error) {
+			fprintf(output, _CTESTER_INDENT "%s:%d: Updated golden file %s.\n", file, line, resolved_path);
+			matches = 1;
+		}
+		else {
+			fprintf(output, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Failed to update golden file %s: %s\n", file, line, resolved_path,
+				strerror(write_error));
+		}
+		funlockfile(output);
+	}
+	else if(!matches) {
+		flockfile(output);
+		fprintf(output, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s to match golden file %s but\n", file, line, buffer_text, resolved_path);
+		if(error) {
+			fprintf(output, _CTESTER_INDENT "    it cannot be read: %s", strerror(error));
+		}
+		else {
+			fprintf(output, _CTESTER_INDENT "    they differ at offset %zu, with %zu bytes in %s and %zu bytes in the golden file", first, size, buffer_text, golden_size);
+		}
+		if(has_message) {
+			va_list arguments;
+			va_start(arguments, message_format);
+			vfprintf(output, message_format, arguments);
+			va_end(arguments);
+		}
+		// Text is easier to read as a diff, which also shows insertions and removals
+		int is_text = !error && size <= _CTESTER_DIFF_MAX_INPUT && golden_size <= _CTESTER_DIFF_MAX_INPUT && !memchr(buffer, 0, size) &&
+			(!golden_size || !memchr(golden, 0, golden_size)) && (memchr(buffer, '\n', size) || (golden_size && memchr(golden, '\n', golden_size)));
+		if(is_text) {
+			fprintf(output, ":\n");
+			print_diff(output, buffer, size, (const char *)golden, golden_size, buffer_text, path);
+		}
+		else if(!error && common_size) {
+			fprintf(output, ":\n");
+			struct ctester_array_t array = { .a = buffer, .b = golden, .count = common_size, .element_size = 1, .kind = _CTESTER_VALUE_MEMORY };
+			print_hexdump(output, &array, buffer_text, path, first);
+		}
+		else {
+			fprintf(output, "\n");
+		}
+		fprintf(output, _CTESTER_INDENT "    Run with --update-golden to replace the golden file.\n");
+		funlockfile(output);
+	}
+
+	if(golden) {
+		munmap((void *)golden, golden_size);
+	}
+	if(fd >= 0) {
+		close(fd);
+	}
+	free(resolved_path);
+	// Last, as a fatal failure within a meta-assertion does not return
+	if(!matches) {
+		record_failure(ctester_state, fatal, line);
+	}
+	return matches;
+}
+
+void _ctester_meta_begin(struct ctester_meta_assertion_t *meta) {
+	memset(meta, 0, sizeof(struct ctester_meta_assertion_t));
+	meta->state.output = open_memstream(&meta->output, &meta->output_size);
+	meta->state.fatal_jump = &meta->fatal_jump;
+}
+
+int _ctester_meta_end(struct ctester_meta_assertion_t *meta, int fatal, int expected_failures, const char *statement, const char *file, int line, FILE *output) {
+	if(meta->state.output) {
+		fclose(meta->state.output);
+	}
+	int warnings = meta->state.warning;
+	int matches = fatal ? meta->state.failed != 0 : !meta->state.failed && warnings == expected_failures;
+	if(!matches) {
+		fprintf(output, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s to report ", file, line, statement);
+		if(fatal) {
+			fprintf(output, "a fatal failure but\n");
+		}
+		else {
+			fprintf(output, "%d nonfatal failure%s but\n", expected_failures, expected_failures == 1 ? "" : "s");
+		}
+		fprintf(output, _CTESTER_INDENT "    it reported %d nonfatal failure%s%s\n", warnings, warnings == 1 ? "" : "s", meta->state.failed ? " and a fatal one" : "");
+		if(meta->output_size) {
+			fprintf(output, _CTESTER_INDENT "    Failures reported:\n");
+			for(char *output_line = strtok(meta->output, "\n"); output_line; output_line = strtok(NULL, "\n")) {
+				fprintf(output, _CTESTER_INDENT "    %s\n", output_line);
+			}
+		}
+	}
+	free(meta->output);
+	return matches;
+}
+
+/**
+ * Number of parameter sets a generator produces.
+ */
+static size_t generator_size(const struct ctester_generator_t *generator) {
+	switch(generator->kind) {
+		case _CTESTER_GENERATOR_RANGE:
+			if(generator->step > 0 && generator->end > generator->start) {
+				return (generator->end - generator->start + generator->step - 1) / generator->step;
+			}
+			if(generator->step < 0 && generator->end < generator->start) {
+				return (generator->start - generator->end - generator->step - 1) / -generator->step;
+			}
+			return 0;
+		case _CTESTER_GENERATOR_VALUES:
+			return generator->count;
+		default: {
+			size_t size = 1;
+			for(size_t i = 0; i < generator->count; i++) {
+				size *= generator_size(generator->factors[i]);
+			}
+			return size;
+		}
+	}
+}
+
+/**
+ * Number of parameters in each set a generator produces.
+ */
+static int generator_width(const struct ctester_generator_t *generator) {
+	if(generator->kind != _CTESTER_GENERATOR_COMBINE) {
+		return 1;
+	}
+	int width = 0;
+	for(size_t i = 0; i < generator->count; i++) {
+		width += generator_width(generator->factors[i]);
+	}
+	return width;
+}
+
+/**
+ * Compute the parameter set at `index` of a generator into `params`.
+ *
+ * Combinations are enumerated with the last generator varying fastest.
+ */
+static void generator_get(const struct ctester_generator_t *generator, size_t index, union ctester_param_t *params) {
+	switch(generator->kind) {
+		case _CTESTER_GENERATOR_RANGE:
+			params[0].integer = generator->start + (long long)index * generator->step;
+			break;
+		case _CTESTER_GENERATOR_VALUES:
+			params[0].value = (const char *)generator->values + index * generator->value_size;
+			break;
+		default: {
+			int offset = generator_width(generator);
+			for(size_t i = generator->count; i-- > 0; ) {
+				const struct ctester_generator_t *factor = generator->factors[i];
+				size_t size = generator_size(factor);
+				offset -= generator_width(factor);
+				generator_get(factor, index % size, params + offset);
+				index /= size;
+			}
+		}
+	}
+}
+
+/**
+ * Open a performance counter for this process. Hardware counters join the
+ * group led by `group_fd` if it is not -1, such that they are scheduled
+ * together. Returns the file descriptor, or -1 with errno set.
+ */
+static int counter_open(int counter, int group_fd) {
+	struct perf_event_attr attributes;
+	memset(&attributes, 0, sizeof(attributes));
+	attributes.size = sizeof(attributes);
+	attributes.type = counter_events[counter].type;
+	attributes.config = counter_events[counter].config;
+	attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	int fd = syscall(SYS_perf_event_open, &attributes, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+	if(fd < 0 && errno == EACCES) {
+		// With kernel.perf_event_paranoid >= 2, only user space may be counted
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		fd = syscall(SYS_perf_event_open, &attributes, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+	}
+	return fd;
+}
+
+/**
+ * Open the counters selected with `--counters` in this process, unless that
+ * happened already.
+ *
+ * With `report` set, i.e. in the main process at startup, counters that are
+ * not available are reported and removed from the selection. If no hardware
+ * counter is available, e.g. within a container, software counters are
+ * selected instead.
+ */
+static void counters_open(int report) {
+	if(!options.counters || counters.pid == getpid()) {
+		return;
+	}
+	if(counters.pid) {
+		// Inherited from the parent process, and counting that one
+		for(int i = 0; i < _CTESTER_NUMBER_OF_COUNTERS; i++) {
+			if(counters.fds[i] >= 0) {
+				close(counters.fds[i]);
+			}
+		}
+	}
+	counters.pid = getpid();
+
+	int group_fd = -1, hardware_failures = 0, hardware_errno = 0;
+	for(int i = 0; i < _CTESTER_NUMBER_OF_COUNTERS; i++) {
+		counters.fds[i] = -1;
+		if(!(options.counters & (1U << i))) {
+			continue;
+		}
+		int hardware = counter_events[i].type == PERF_TYPE_HARDWARE;
+		counters.fds[i] = counter_open(i, hardware ? group_fd : -1);
+		if(counters.fds[i] >= 0) {
+			if(hardware && group_fd < 0) {
+				group_fd = counters.fds[i];
+			}
+			continue;
+		}
+		if(!report) {
+			continue;
+		}
+		if(hardware) {
+			hardware_failures++;
+			hardware_errno = errno;
+		}
+		else {
+			print_info(33, _CTESTER_INFO_WARNING, "Counter %s is not available: %s\n", counter_events[i].name, strerror(errno));
+		}
+		options.counters &= ~(1U << i);
+	}
+	if(!report || !hardware_failures) {
+		return;
+	}
+	if(group_fd >= 0) {
+		print_info(33, _CTESTER_INFO_WARNING, "Some hardware performance counters are not available: %s\n", strerror(hardware_errno));
+		return;
+	}
+	print_info(33, _CTESTER_INFO_WARNING, "Hardware performance counters are not available (%s), counting task-clock, page-faults and context-switches instead.\n", strerror(hardware_errno));
+	for(int i = 0; i < _CTESTER_NUMBER_OF_COUNTERS; i++) {
+		if(counter_events[i].type == PERF_TYPE_SOFTWARE && counters.fds[i] < 0) {
+			counters.fds[i] = counter_open(i, -1);
+			if(counters.fds[i] >= 0) {
+				options.counters |= 1U << i;
+			}
+		}
+	}
+}
+
+/**
+ * Read a counter. Returns 0 if that fails, or if the counter is not open in
+ * this process.
+ */
+static int counter_read(int counter, struct ctester_counter_reading_t *reading) {
+	return counters.pid == getpid() && counters.fds[counter] >= 0 && read(counters.fds[counter], reading, sizeof(*reading)) == sizeof(*reading);
+}
+
+/**
+ * Number of events counted between two readings, extrapolated if the
+ * kernel multiplexed the counter with others in between.
+ */
+static unsigned long long counter_difference(struct ctester_counter_reading_t *start, struct ctester_counter_reading_t *end) {
+	uint64_t value = end->value - start->value;
+	uint64_t time_enabled = end->time_enabled - start->time_enabled;
+	uint64_t time_running = end->time_running - start->time_running;
+	if(time_running == 0) {
+		return 0;
+	}
+	if(time_running < time_enabled) {
+		return (double)value * time_enabled / time_running;
+	}
+	return value;
+}
+
+unsigned long long _ctester_counter(int counter) {
+	struct ctester_counter_reading_t reading;
+	if(counter < 0 || counter >= _CTESTER_NUMBER_OF_COUNTERS || !counter_read(counter, &reading)) {
+		return 0;
+	}
+	return counter_difference(&counters.start[counter], &reading);
+}
+
+/**
+ * Take the start values of the counters for the test about to run.
+ */
+static void counters_begin() {
+	counters_open(0);
+	for(int i = 0; i < _CTESTER_NUMBER_OF_COUNTERS; i++) {
+		if(!counter_read(i, &counters.start[i])) {
+			memset(&counters.start[i], 0, sizeof(struct ctester_counter_reading_t));
+		}
+	}
+}
+
+/**
+ * Store the counts of the test that just ran in `result`.
+ */
+static void counters_end(struct ctester_test_result_t *result) {
+	result->counters_mask = 0;
+	for(int i = 0; i < _CTESTER_NUMBER_OF_COUNTERS; i++) {
+		struct ctester_counter_reading_t reading;
+		if(options.counters & (1U << i) && counter_read(i, &reading)) {
+			result->counters[i] = counter_difference(&counters.start[i], &reading);
+			result->counters_mask |= 1U << i;
+		}
+	}
+}
+
+/**
+ * Run a single test in the current process.
+ */
+static void run_test(struct ctester_test_case_list_t *test, struct ctester_test_result_t *result) {
+	struct ctester_test_case_state_t state;
+	memset(&state, 0, sizeof(struct ctester_test_case_state_t));
+	union ctester_param_t params[_CTESTER_MAX_PARAMS];
+	if(test->param_body) {
+		generator_get(test->generator, test->param_index, params);
+	}
+
+	capture_begin();
+	if(options.timeout_ms || options.deadline) {
+		// The watchdog cannot flush stdout from within its signal handler
+		fflush(stdout);
+	}
+	watchdog.test = test;
+	if(options.timeout_ms) {
+		watchdog_arm(options.timeout_ms);
+	}
+	if(&ctester_alloc_stats) {
+		memset(&ctester_alloc_stats, 0, sizeof(struct ctester_alloc_stats_t));
+	}
+	counters_begin();
+	unsigned long long test_start_time = get_clock_ns();
+	// This is where the actual test case is executed
+	if(test->param_body) {
+		test->param_body(&state, params);
+	}
+	else {
+		test->test_body(&state);
+	}
+	result->body_duration = get_clock_ns() - test_start_time;
+	counters_end(result);
+	result->has_allocs = &ctester_alloc_stats != NULL;
+	if(result->has_allocs) {
+		result->allocs = ctester_alloc_stats;
+	}
+	if(options.timeout_ms) {
+		watchdog_arm(0);
+	}
+	watchdog.test = NULL;
+	capture_end();
+	result->duration = get_clock_ns() - test_start_time;
+
+	result->failed = state.failed;
+	result->warning = state.warning;
+	result->status = 0;
+	result->has_usage = 0;
+	result->timed_out = 0;
+}
+
+/**
+ * Prepare the result that the watchdog sends to the parent process in case
+ * the next test times out.
+ */
+static void prepare_timeout_result(struct ctester_test_result_t *result) {
+	memset(result, 0, sizeof(struct ctester_test_result_t));
+	result->failed = -1;
+	result->timed_out = 1;
+	result->duration = options.timeout_ms * 1000000ULL;
+	result->body_duration = result->duration;
+}
+
+/**
+ * Whether an isolated test used more memory than allowed by `--max-rss`.
+ */
+static int exceeded_max_rss(struct ctester_test_result_t *result) {
+	// ru_maxrss is in KiB
+	return options.max_rss && result->has_usage && (unsigned long)result->usage.ru_maxrss > options.max_rss * 1024;
+}
+
+/**
+ * Run a single test in a child process of its own, see `--isolate`.
+ *
+ * This is the same idea as ::_CTESTER_TEST_RUN_AS_CHILD, but for the whole
+ * test body: The child runs the test and sends back its result, and the parent
+ * collects the child's resource usage through wait4(2). A test whose process
+ * dies or exceeds the resource limits is reported as failed.
+ */
+static void run_test_isolated(struct ctester_test_case_list_t *test, struct ctester_test_result_t *result) {
+	int result_pipe[2];
+	if(pipe(result_pipe) < 0) {
+		print_info(31, _CTESTER_INFO_FAILED, "Failed to create a pipe for an isolated test: %s\n", strerror(errno));
+		exit(1);
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	unsigned long long test_start_time = get_clock_ns();
+	pid_t child_pid = fork();
+	if(child_pid < 0) {
+		print_info(31, _CTESTER_INFO_FAILED, "Failed to fork for an isolated test: %s\n", strerror(errno));
+		exit(1);
+	}
+	if(child_pid == 0) {
+		close(result_pipe[0]);
+		watchdog_forked();
+		watchdog.result_fd = result_pipe[1];
+		prepare_timeout_result((struct ctester_test_result_t *)watchdog.message);
+		watchdog.message_size = sizeof(struct ctester_test_result_t);
+		// Linux does not enforce RLIMIT_RSS, so --max-rss is checked against ru_maxrss after the test. The
+		// address space also counts reservations such as thread stacks and malloc arenas, and is limited separately.
+		if(options.max_address_space) {
+			struct rlimit limit = { .rlim_cur = options.max_address_space << 20, .rlim_max = options.max_address_space << 20 };
+			setrlimit(RLIMIT_AS, &limit);
+		}
+		if(options.max_cpu) {
+			struct rlimit limit = { .rlim_cur = options.max_cpu, .rlim_max = options.max_cpu + 1 };
+			setrlimit(RLIMIT_CPU, &limit);
+		}
+		struct ctester_test_result_t child_result;
+		run_test(test, &child_result);
+		fflush(stdout);
+		fflush(stderr);
+		write_full(result_pipe[1], &child_result, sizeof(child_result));
+		_exit(0);
+	}
+
+	close(result_pipe[1]);
+	watchdog.isolated_child = child_pid;
+	int got_result = read_full(result_pipe[0], result, sizeof(*result)) == sizeof(*result);
+	close(result_pipe[0]);
+
+	int status = 0;
+	while(wait4(child_pid, &status, 0, &result->usage) < 0 && errno == EINTR);
+	watchdog.isolated_child = 0;
+	result->has_usage = 1;
+	result->duration = get_clock_ns() - test_start_time;
+
+	if(got_result && result->timed_out) {
+		result->status = status;
+	}
+	else if(!got_result || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		result->failed = -1;
+		result->warning = 0;
+		result->status = status;
+		result->body_duration = result->duration;
+		result->timed_out = 0;
+	}
+	else if(exceeded_max_rss(result)) {
+		result->failed = -1;
+	}
+}
+
+/**
+ * Run the ::TEAR_DOWN_TEST_CASE hook of the current test case, if any.
+ */
+static void leave_test_case() {
+	struct ctester_test_case_list_t *test = current_test_case.test;
+	current_test_case.test = NULL;
+	if(test && test->tear_down_test_case && !current_test_case.failed) {
+		struct ctester_test_case_state_t state;
+		memset(&state, 0, sizeof(struct ctester_test_case_state_t));
+		fflush(stdout);
+		test->tear_down_test_case(&state);
+		fflush(stderr);
+		if(state.failed || state.warning) {
+			print_info(33, _CTESTER_INFO_WARNING, "TEAR_DOWN_TEST_CASE of %s failed.\n", test->test_case_name);
+		}
+	}
+}
+
+/**
+ * Run the ::SET_UP_TEST_CASE hook of the test case of `test`, unless this
+ * process is in that test case already. The ::TEAR_DOWN_TEST_CASE hook of the
+ * previous test case runs first.
+ *
+ * Tests run isolated are forked off after this, such that they share the
+ * state the hook set up. Workers of `-j` run the hook themselves, once per
+ * test case they execute tests of.
+ *
+ * Returns the line at which the hook failed, or 0.
+ */
+static int enter_test_case(struct ctester_test_case_list_t *test) {
+	if(current_test_case.test && strcmp(current_test_case.test->test_case_name, test->test_case_name) == 0) {
+		return current_test_case.failed;
+	}
+	leave_test_case();
+	current_test_case.test = test;
+	current_test_case.failed = 0;
+	if(test->set_up_test_case) {
+		struct ctester_test_case_state_t state;
+		memset(&state, 0, sizeof(struct ctester_test_case_state_t));
+		fflush(stdout);
+		test->set_up_test_case(&state);
+		fflush(stderr);
+		if(state.failed) {
+			print_info(31, _CTESTER_INFO_FAILED, "SET_UP_TEST_CASE of %s failed, skipping its tests.\n", test->test_case_name);
+			current_test_case.failed = state.failed;
+		}
+	}
+	return current_test_case.failed;
+}
+
+/**
+ * Run a single test in the way requested on the command line.
+ */
+static void execute_test(struct ctester_test_case_list_t *test, struct ctester_test_result_t *result) {
+	if(enter_test_case(test)) {
+		memset(result, 0, sizeof(struct ctester_test_result_t));
+		result->failed = current_test_case.failed;
+		return;
+	}
+	if(options.isolate) {
+		run_test_isolated(test, result);
+	}
+	else {
+		run_test(test, result);
+	}
+}
+
+/**
+ * Print the resources used by an isolated test, as part of its OK/FAILED line.
+ */
+static void print_usage(struct ctester_test_result_t *result) {
+	if(result->has_allocs) {
+		char bytes[32], peak_live_bytes[32];
+		printf(", %llu alloc%s, %s, %s peak",
+			result->allocs.allocations, result->allocs.allocations == 1 ? "" : "s",
+			format_bytes(bytes, sizeof(bytes), result->allocs.bytes),
+			format_bytes(peak_live_bytes, sizeof(peak_live_bytes), result->allocs.peak_live_bytes));
+		if(result->allocs.live_bytes > 0) {
+			char live_bytes[32];
+			printf(", %s leaked", format_bytes(live_bytes, sizeof(live_bytes), result->allocs.live_bytes));
+		}
+	}
+	for(int i = 0; i < _CTESTER_NUMBER_OF_COUNTERS; i++) {
+		if(!(result->counters_mask & (1U << i))) {
+			continue;
+		}
+		if(i == _CTESTER_COUNTER_TASK_CLOCK) {
+			char duration[32];
+			printf(", %s %s", format_duration(duration, sizeof(duration), result->counters[i]), counter_events[i].name);
+		}
+		else {
+			printf(", %llu %s", result->counters[i], counter_events[i].name);
+		}
+	}
+	if(!result->has_usage) {
+		return;
+	}
+	struct rusage *usage = &result->usage;
+	printf(", %ld kB max RSS, %ld ms user, %ld ms sys, %ld/%ld major/minor faults, %ld/%ld voluntary/involuntary context switches",
+		usage->ru_maxrss,
+		usage->ru_utime.tv_sec * 1000 + usage->ru_utime.tv_usec / 1000,
+		usage->ru_stime.tv_sec * 1000 + usage->ru_stime.tv_usec / 1000,
+		usage->ru_majflt, usage->ru_minflt,
+		usage->ru_nvcsw, usage->ru_nivcsw);
+}
+
+/**
+ * qsort(3) comparator for doubles.
+ */
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * Time `iterations` calls of a benchmark's operation, in nanoseconds.
+ */
+static unsigned long long time_benchmark(struct ctester_test_case_list_t *test, struct ctester_test_case_state_t *state, unsigned long iterations) {
+	unsigned long long start_time = get_clock_ns();
+	test->benchmark_body(state, iterations);
+	return get_clock_ns() - start_time;
+}
+
+/**
+ * Run a benchmark.
+ *
+ * The number of iterations per sample is calibrated such that all samples
+ * together take about `--bench-time` milliseconds. After a warmup phase,
+ * ::_CTESTER_BENCHMARK_SAMPLES samples are taken and summarized in `stats`.
+ */
+static void run_benchmark(struct ctester_test_case_list_t *test, struct ctester_test_result_t *result, struct ctester_benchmark_stats_t *stats) {
+	struct ctester_test_case_state_t state;
+	memset(&state, 0, sizeof(struct ctester_test_case_state_t));
+	memset(stats, 0, sizeof(struct ctester_benchmark_stats_t));
+
+	unsigned long long benchmark_start_time = get_clock_ns();
+	unsigned long long sample_time = options.bench_time * 1000000ULL / _CTESTER_BENCHMARK_SAMPLES;
+	double samples[_CTESTER_BENCHMARK_SAMPLES];
+
+	// Calibrate the number of iterations per sample. This doubles as the first
+	// part of the warmup.
+	unsigned long iterations = 1;
+	while(!state.failed) {
+		unsigned long long elapsed = time_benchmark(test, &state, iterations);
+		if(elapsed >= sample_time || iterations >= (1UL << 40)) {
+			break;
+		}
+		unsigned long multiplier = elapsed > 0 ? 1.4 * sample_time / elapsed : 100;
+		iterations *= multiplier < 2 ? 2 : (multiplier > 100 ? 100 : multiplier);
+	}
+
+	// Warm up for another tenth of the target time
+	for(int i = 0; i < _CTESTER_BENCHMARK_SAMPLES / 10 && !state.failed; i++) {
+		time_benchmark(test, &state, iterations);
+	}
+
+	for(int i = 0; i < _CTESTER_BENCHMARK_SAMPLES && !state.failed; i++) {
+		samples[i] = (double)time_benchmark(test, &state, iterations) / iterations;
+	}
+
+	result->duration = get_clock_ns() - benchmark_start_time;
+	result->body_duration = result->duration;
+	result->failed = state.failed;
+	result->warning = state.warning;
+	result->status = 0;
+	result->has_usage = 0;
+	if(state.failed) {
+		return;
+	}
+
+	double sum = 0, squared_deviations = 0;
+	for(int i = 0; i < _CTESTER_BENCHMARK_SAMPLES; i++) {
+		sum += samples[i];
+	}
+	stats->mean = sum / _CTESTER_BENCHMARK_SAMPLES;
+	for(int i = 0; i < _CTESTER_BENCHMARK_SAMPLES; i++) {
+		squared_deviations += (samples[i] - stats->mean) * (samples[i] - stats->mean);
+	}
+	stats->stddev = sqrt(squared_deviations / (_CTESTER_BENCHMARK_SAMPLES - 1));
+
+	qsort(samples, _CTESTER_BENCHMARK_SAMPLES, sizeof(double), compare_doubles);
+	stats->min = samples[0];
+	stats->median = (samples[(_CTESTER_BENCHMARK_SAMPLES - 1) / 2] + samples[_CTESTER_BENCHMARK_SAMPLES / 2]) / 2;
+	stats->p99 = samples[(_CTESTER_BENCHMARK_SAMPLES * 99 + 99) / 100 - 1];
+	stats->iterations = iterations;
+}
+
+int _ctester_timing_next(struct ctester_timing_t *timing) {
+	unsigned long long now = get_clock_ns();
+	if(!timing->iterations) {
+		timing->iterations = 1;
+		timing->start = now;
+		return 1;
+	}
+
+	unsigned long long elapsed = now - timing->start;
+	if(timing->number_of_samples == 0 && elapsed < _CTESTER_TIMING_MIN_BATCH_NS && timing->iterations < (1UL << 40)) {
+		// Calibrate like run_benchmark(), discarding the batch
+		unsigned long multiplier = elapsed > 0 ? 1.4 * _CTESTER_TIMING_MIN_BATCH_NS / elapsed : 100;
+		timing->iterations *= multiplier < 2 ? 2 : (multiplier > 100 ? 100 : multiplier);
+	}
+	else {
+		timing->samples[timing->number_of_samples++] = (double)elapsed / timing->iterations;
+		if(timing->number_of_samples == _CTESTER_TIMING_SAMPLES) {
+			qsort(timing->samples, _CTESTER_TIMING_SAMPLES, sizeof(double), compare_doubles);
+			timing->median = timing->samples[_CTESTER_TIMING_SAMPLES / 2];
+			return 0;
+		}
+	}
+	timing->start = get_clock_ns();
+	return 1;
+}
+
+/**
+ * Evaluate the model of a complexity class at input size `n`.
+ */
+static double complexity_model(int complexity, double n) {
+	switch(complexity) {
+		case O_LOG_N:
+			return log2(n);
+		case O_N:
+			return n;
+		case O_N_LOG_N:
+			return n * log2(n);
+		case O_N_SQUARED:
+			return n * n;
+		default:
+			return 1;
+	}
+}
+
+int _ctester_check_complexity(void (*function)(size_t n), const size_t *sizes, size_t count, int complexity, const char *function_name, const char *file, int line, FILE *output) {
+	static const char *complexity_names[] = { "O(1)", "O(log n)", "O(n)", "O(n log n)", "O(n^2)" };
+	// Time the sizes in rounds of one batch each, such that changes in the
+	// speed of the machine affect all of them alike
+	struct ctester_timing_t timings[count];
+	memset(timings, 0, sizeof(timings));
+	for(int round = 0; round < _CTESTER_TIMING_SAMPLES; round++) {
+		for(size_t i = 0; i < count; i++) {
+			struct ctester_timing_t *timing = &timings[i];
+			int number_of_samples = timing->number_of_samples;
+			do {
+				timing->start = get_clock_ns();
+				for(unsigned long j = 0; j < timing->iterations; j++) {
+					function(sizes[i]);
+				}
+			} while(_ctester_timing_next(timing) && timing->number_of_samples == number_of_samples);
+		}
+	}
+
+	// Fit duration = c * model(n) for each model, minimizing the squared
+	// relative errors, and pick the model with the smallest root mean square
+	// error. Simpler models win ties.
+	int best_fit = O_1;
+	double best_error = INFINITY;
+	for(int model = O_1; model <= O_N_SQUARED; model++) {
+		double sum = 0, squares = 0;
+		for(size_t i = 0; i < count; i++) {
+			double ratio = complexity_model(model, sizes[i]) / timings[i].median;
+			sum += ratio;
+			squares += ratio * ratio;
+		}
+		if(squares == 0 || !isfinite(squares)) {
+			continue;
+		}
+		double factor = sum / squares, squared_errors = 0;
+		for(size_t i = 0; i < count; i++) {
+			double error = 1 - factor * complexity_model(model, sizes[i]) / timings[i].median;
+			squared_errors += error * error;
+		}
+		if(squared_errors < best_error) {
+			best_fit = model;
+			best_error = squared_errors;
+		}
+	}
+	if(best_fit <= complexity) {
+		return 1;
+	}
+
+	fprintf(output, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s to be at most %s but\n" _CTESTER_INDENT "    best fit == %s", file, line, function_name,
+		complexity >= O_1 ? complexity_names[complexity] : "?", complexity_names[best_fit]);
+	for(size_t i = 0; i < count; i++) {
+		char duration[32];
+		fprintf(output, ",\n" _CTESTER_INDENT "    %s(%zu) == %s", function_name, sizes[i], format_duration(duration, sizeof(duration), timings[i].median));
+	}
+	return 0;
+}
+
+/**
+ * Main loop of a worker process: Run the tests whose indices arrive on
+ * `command_fd` and send the results back through `result_fd`, until the
+ * parent closes the pipe.
+ */
+static void __attribute__((noreturn)) worker_main(struct ctester_pool_t *pool, int command_fd, int result_fd) {
+	int index;
+	watchdog.result_fd = result_fd;
+	watchdog.message_size = sizeof(struct ctester_worker_message_t);
+	while(read_full(command_fd, &index, sizeof(index)) == sizeof(index)) {
+		struct ctester_worker_message_t message;
+		memset(&message, 0, sizeof(message));
+		message.index = index;
+		prepare_timeout_result(&message.result);
+		memcpy(watchdog.message, &message, sizeof(message));
+		execute_test(pool->schedule[index], &message.result);
+		fflush(stdout);
+		fflush(stderr);
+		if(write_full(result_fd, &message, sizeof(message)) < 0) {
+			break;
+		}
+	}
+	leave_test_case();
+	fflush(stdout);
+	_exit(0);
+}
+
+/**
+ * Fork a (replacement) worker into slot `slot` of the pool.
+ */
+static void pool_spawn_worker(struct ctester_pool_t *pool, int slot) {
+	struct ctester_worker_t *worker = &pool->workers[slot];
+	int command_pipe[2], result_pipe[2];
+
+	if(pipe(command_pipe) < 0 || pipe(result_pipe) < 0) {
+		print_info(31, _CTESTER_INFO_FAILED, "Failed to create a pipe for a worker: %s\n", strerror(errno));
+		exit(1);
+	}
+
+	// Each worker captures the output of its tests in a file of its own, which
+	// the parent reads whenever a result arrives
+	worker->capture_fd = options.capture ? capture_create() : -1;
+
+	fflush(stdout);
+	fflush(stderr);
+	pid_t pid = fork();
+	if(pid < 0) {
+		print_info(31, _CTESTER_INFO_FAILED, "Failed to fork a worker: %s\n", strerror(errno));
+		exit(1);
+	}
+	if(pid == 0) {
+		signal(SIGPIPE, SIG_DFL);
+		watchdog_forked();
+		if(capture.fd >= 0) {
+			close(capture.fd);
+		}
+		capture.fd = worker->capture_fd;
+		for(int i = 0; i < pool->number_of_workers; i++) {
+			if(i != slot && pool->workers[i].pid > 0) {
+				close(pool->workers[i].command_fd);
+				close(pool->workers[i].result_fd);
+				if(pool->workers[i].capture_fd >= 0) {
+					close(pool->workers[i].capture_fd);
+				}
+			}
+		}
+		close(command_pipe[1]);
+		close(result_pipe[0]);
+		worker_main(pool, command_pipe[0], result_pipe[1]);
+	}
+
+	close(command_pipe[0]);
+	close(result_pipe[1]);
+	worker->pid = pid;
+	worker->command_fd = command_pipe[1];
+	worker->result_fd = result_pipe[0];
+	worker->current = -1;
+}
+
+/**
+ * Collect a worker that went away. The test it was running is marked as
+ * failed, and the worker is replaced if there is work left.
+ */
+static void pool_reap_worker(struct ctester_pool_t *pool, int slot) {
+	struct ctester_worker_t *worker = &pool->workers[slot];
+	int status = 0;
+
+	close(worker->command_fd);
+	close(worker->result_fd);
+	while(waitpid(worker->pid, &status, 0) < 0 && errno == EINTR);
+	worker->pid = 0;
+
+	if(worker->current >= 0) {
+		struct ctester_test_result_t *result = &pool->results[worker->current];
+		capture_read(worker->capture_fd, result);
+		result->failed = -1;
+		result->warning = 0;
+		result->status = status;
+		result->duration = get_clock_ns() - worker->start_time;
+		result->body_duration = result->duration;
+		result->has_usage = 0;
+		result->timed_out = 0;
+		pool->done[worker->current] = 1;
+		worker->current = -1;
+	}
+	if(worker->capture_fd >= 0) {
+		close(worker->capture_fd);
+		worker->capture_fd = -1;
+	}
+
+	if(pool->next_index < pool->schedule_length) {
+		pool_spawn_worker(pool, slot);
+	}
+}
+
+/**
+ * Hand out tests to idle workers, then wait for at least one of the busy
+ * workers to report back.
+ */
+static void pool_pump(struct ctester_pool_t *pool) {
+	struct pollfd fds[pool->number_of_workers];
+	int slots[pool->number_of_workers];
+	int number_of_fds = 0;
+
+	for(int i = 0; i < pool->number_of_workers; i++) {
+		struct ctester_worker_t *worker = &pool->workers[i];
+		if(worker->pid > 0 && worker->current < 0 && pool->next_index < pool->schedule_length) {
+			int index = pool->next_index++;
+			worker->current = index;
+			worker->start_time = get_clock_ns();
+			if(write_full(worker->command_fd, &index, sizeof(index)) < 0) {
+				pool_reap_worker(pool, i);
+				continue;
+			}
+		}
+		if(worker->pid > 0 && worker->current >= 0) {
+			fds[number_of_fds].fd = worker->result_fd;
+			fds[number_of_fds].events = POLLIN;
+			slots[number_of_fds] = i;
+			number_of_fds++;
+		}
+	}
+
+	if(number_of_fds == 0 || poll(fds, number_of_fds, -1) < 0) {
+		return;
+	}
+
+	for(int i = 0; i < number_of_fds; i++) {
+		if(!fds[i].revents) {
+			continue;
+		}
+		struct ctester_worker_t *worker = &pool->workers[slots[i]];
+		struct ctester_worker_message_t message;
+		if(read_full(worker->result_fd, &message, sizeof(message)) != sizeof(message) || message.index != worker->current) {
+			pool_reap_worker(pool, slots[i]);
+			continue;
+		}
+		pool->results[message.index] = message.result;
+		capture_read(worker->capture_fd, &pool->results[message.index]);
+		pool->done[message.index] = 1;
+		worker->current = -1;
+		if(message.result.timed_out) {
+			// The worker exits after reporting a timeout
+			pool_reap_worker(pool, slots[i]);
+		}
+	}
+}
+
+/**
+ * Start `number_of_workers` workers for the given schedule.
+ */
+static struct ctester_pool_t *pool_create(struct ctester_test_case_list_t **schedule, int schedule_length, int number_of_workers) {
+	struct ctester_pool_t *pool = calloc(1, sizeof(struct ctester_pool_t));
+	pool->schedule = schedule;
+	pool->schedule_length = schedule_length;
+	pool->results = calloc(schedule_length ? schedule_length : 1, sizeof(struct ctester_test_result_t));
+	pool->done = calloc(schedule_length ? schedule_length : 1, 1);
+	pool->number_of_workers = number_of_workers < schedule_length ? number_of_workers : schedule_length;
+	pool->workers = calloc(pool->number_of_workers ? pool->number_of_workers : 1, sizeof(struct ctester_worker_t));
+
+	// A worker dying must not take the parent with it when it writes the next command
+	signal(SIGPIPE, SIG_IGN);
+
+	for(int i = 0; i < pool->number_of_workers; i++) {
+		pool_spawn_worker(pool, i);
+	}
+	return pool;
+}
+
+/**
+ * Block until the result of the test at `index` in the schedule is available.
+ */
+static struct ctester_test_result_t *pool_wait(struct ctester_pool_t *pool, int index) {
+	while(!pool->done[index]) {
+		pool_pump(pool);
+	}
+	return &pool->results[index];
+}
+
+/**
+ * Shut down all workers.
+ */
+static void pool_destroy(struct ctester_pool_t *pool) {
+	for(int i = 0; i < pool->number_of_workers; i++) {
+		if(pool->workers[i].pid > 0) {
+			close(pool->workers[i].command_fd);
+			close(pool->workers[i].result_fd);
+			if(pool->workers[i].capture_fd >= 0) {
+				close(pool->workers[i].capture_fd);
+			}
+			while(waitpid(pool->workers[i].pid, NULL, 0) < 0 && errno == EINTR);
+		}
+	}
+	free(pool->workers);
+	free(pool->results);
+	free(pool->done);
+	free(pool);
+}
+
+/**
+ * qsort(3) comparator ordering ::ctester_test_timing_t by descending duration.
+ */
+static int compare_timings(const void *a, const void *b) {
+	unsigned long long x = ((const struct ctester_test_timing_t *)a)->duration, y = ((const struct ctester_test_timing_t *)b)->duration;
+	return (x < y) - (x > y);
+}
+
+/**
+ * List the `count` tests that took longest, see `--slowest`.
+ */
+static void print_slowest(struct ctester_test_timing_t *timings, int number_of_timings, int count) {
+	qsort(timings, number_of_timings, sizeof(struct ctester_test_timing_t), compare_timings);
+	if(count > number_of_timings) {
+		count = number_of_timings;
+	}
+	print_info(32, _CTESTER_INFO_THIN_BAR, "%d slowest test%s:\n", count, count == 1 ? "" : "s");
+	for(int i = 0; i < count; i++) {
+		char duration[32];
+		print_info(32, _CTESTER_INFO_SLOW, "%s (%s)\n", timings[i].test->full_test_name, format_duration(duration, sizeof(duration), timings[i].duration));
+	}
+}
+
+/**
+ * qsort(3) comparator ordering tests by name. Numbers within names are
+ * compared by value, such that the instances of a ::TEST_P are in order.
+ */
+static int compare_tests(const void *a, const void *b) {
+	return strverscmp(((const struct ctester_test_case_list_t *)a)->full_test_name, ((const struct ctester_test_case_list_t *)b)->full_test_name);
+}
+
+/**
+ * bsearch(3) comparator for finding a test in ::ctester_tests by name.
+ */
+static int compare_test_to_name(const void *name, const void *test) {
+	return strverscmp((const char *)name, ((const struct ctester_test_case_list_t *)test)->full_test_name);
+}
+
+/**
+ * Add a module to ::modules.
+ */
+static void add_module(const char *file_name, void *handle, const struct ctester_module_t *sections) {
+	modules = realloc(modules, (number_of_modules + 1) * sizeof(struct ctester_loaded_module_t));
+	if(!modules) {
+		print_info(31, _CTESTER_INFO_FAILED, "Out of memory.\n");
+		exit(1);
+	}
+	modules[number_of_modules].file_name = file_name;
+	modules[number_of_modules].handle = handle;
+	modules[number_of_modules].sections = sections;
+	number_of_modules++;
+}
+
+/**
+ * Load a shared object of tests, see `ctester-module.c`, and add it to
+ * ::modules.
+ *
+ * Modules are loaded with RTLD_LOCAL, such that their own symbols do not
+ * clash, and resolve the functions of ctester against this binary.
+ */
+static void load_module(const char *file_name) {
+	// dlopen(3) only searches the library path for names without a slash
+	char *path;
+	if(asprintf(&path, "%s%s", strchr(file_name, '/') ? "" : "./", file_name) < 0) {
+		print_info(31, _CTESTER_INFO_FAILED, "Out of memory.\n");
+		exit(1);
+	}
+	void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	free(path);
+	if(!handle) {
+		print_info(31, _CTESTER_INFO_FAILED, "Failed to load %s: %s\n", file_name, dlerror());
+		exit(1);
+	}
+	for(int i = 1; i < number_of_modules; i++) {
+		if(modules[i].handle == handle) {
+			print_info(33, _CTESTER_INFO_WARNING, "%s is the same module as %s, loading it once.\n", file_name, modules[i].file_name);
+			dlclose(handle);
+			return;
+		}
+	}
+	const struct ctester_module_t *sections = dlsym(handle, "ctester_module");
+	if(!sections) {
+		print_info(31, _CTESTER_INFO_FAILED, "%s does not export ctester_module, link ctester-module.o into it.\n", file_name);
+		exit(1);
+	}
+	add_module(file_name, handle, sections);
+}
+
+/**
+ * Unload the modules loaded from the command line, after which the tests in
+ * ::ctester_tests may no longer be used.
+ */
+static void unload_modules() {
+	while(number_of_modules > 1) {
+		struct ctester_loaded_module_t *module = &modules[--number_of_modules];
+		if(dlclose(module->handle) != 0) {
+			print_info(33, _CTESTER_INFO_WARNING, "Failed to unload %s: %s\n", module->file_name, dlerror());
+		}
+	}
+}
+
+/**
+ * Copy the tests registered in the `ctester_tests` section of each module
+ * into the ::ctester_tests array and sort them by name.
+ *
+ * A ::TEST_P becomes one test per parameter set of each instantiation of its
+ * test case in the same module. Only the test's name is materialized here;
+ * its parameters are computed from ::ctester_test_case_list_t::param_index
+ * when it runs.
+ */
+static void collect_tests() {
+	size_t number_of_tests = 0;
+	for(struct ctester_loaded_module_t *module = modules; module < modules + number_of_modules; module++) {
+		const struct ctester_module_t *sections = module->sections;
+		int number_of_instantiations = sections->instantiations_stop - sections->instantiations_start;
+		for(struct ctester_test_case_list_t **test = sections->tests_start; test < sections->tests_stop; test++) {
+			if(!(*test)->param_body) {
+				number_of_tests++;
+				continue;
+			}
+			for(int i = 0; i < number_of_instantiations; i++) {
+				const struct ctester_instantiation_t *instantiation = sections->instantiations_start[i];
+				if(strcmp(instantiation->test_case_name, (*test)->test_case_name) == 0) {
+					if(generator_width(instantiation->generator) > _CTESTER_MAX_PARAMS) {
+						print_info(31, _CTESTER_INFO_FAILED, "Instantiation %s of %s generates more than %d parameters.\n", instantiation->prefix, instantiation->test_case_name, _CTESTER_MAX_PARAMS);
+						exit(1);
+					}
+					number_of_tests += generator_size(instantiation->generator);
+				}
+			}
+		}
+	}
+
+	ctester_number_of_tests = 0;
+	ctester_tests = calloc(number_of_tests ? number_of_tests : 1, sizeof(struct ctester_test_case_list_t));
+	for(struct ctester_loaded_module_t *module = modules; module < modules + number_of_modules; module++) {
+		const struct ctester_module_t *sections = module->sections;
+		int number_of_instantiations = sections->instantiations_stop - sections->instantiations_start;
+		for(struct ctester_test_case_list_t **test = sections->tests_start; test < sections->tests_stop; test++) {
+			if(!(*test)->param_body) {
+				ctester_tests[ctester_number_of_tests++] = **test;
+				continue;
+			}
+			for(int i = 0; i < number_of_instantiations; i++) {
+				const struct ctester_instantiation_t *instantiation = sections->instantiations_start[i];
+				if(strcmp(instantiation->test_case_name, (*test)->test_case_name) != 0) {
+					continue;
+				}
+				// All instances share the name of their test case, and point into their full name for the test name
+				char *test_case_name;
+				if(asprintf(&test_case_name, "%s/%s", instantiation->prefix, instantiation->test_case_name) < 0) {
+					print_info(31, _CTESTER_INFO_FAILED, "Out of memory.\n");
+					exit(1);
+				}
+				size_t size = generator_size(instantiation->generator);
+				for(size_t index = 0; index < size; index++) {
+					struct ctester_test_case_list_t *instance = &ctester_tests[ctester_number_of_tests++];
+					*instance = **test;
+					if(asprintf(&instance->full_test_name, "%s.%s/%zu", test_case_name, (*test)->test_name, index) < 0) {
+						print_info(31, _CTESTER_INFO_FAILED, "Out of memory.\n");
+						exit(1);
+					}
+					instance->test_case_name = test_case_name;
+					instance->test_name = instance->full_test_name + strlen(test_case_name) + 1;
+					instance->generator = instantiation->generator;
+					instance->param_index = index;
+				}
+			}
+		}
+	}
+	qsort(ctester_tests, ctester_number_of_tests, sizeof(struct ctester_test_case_list_t), compare_tests);
+
+	// Tests are found by name, e.g. in the history, so names must be unique across modules
+	for(int i = 1; i < ctester_number_of_tests; i++) {
+		if(strcmp(ctester_tests[i - 1].full_test_name, ctester_tests[i].full_test_name) == 0) {
+			print_info(31, _CTESTER_INFO_FAILED, "Test %s is defined more than once.\n", ctester_tests[i].full_test_name);
+			exit(1);
+		}
+	}
+}
+
+/**
+ * Read a timings file, see `--timings`, and store the run times in the
+ * tests' ::expected_duration. Each line holds a test name and its run time
+ * in nanoseconds, separated by a tab. Further fields are ignored. Unless
+ * `overwrite` is set, known durations are kept.
+ *
+ * Returns -1 if the file cannot be read.
+ */
+static int load_timings(const char *file_name, int overwrite) {
+	FILE *file = fopen(file_name, "r");
+	if(!file) {
+		return -1;
+	}
+
+	char *line = NULL;
+	size_t line_size = 0;
+	while(getline(&line, &line_size, file) > 0) {
+		char *separator = strchr(line, '\t');
+		if(!separator) {
+			continue;
+		}
+		*separator = 0;
+		struct ctester_test_case_list_t *test = bsearch(line, ctester_tests, ctester_number_of_tests, sizeof(struct ctester_test_case_list_t), compare_test_to_name);
+		if(test && (overwrite || !test->expected_duration)) {
+			test->expected_duration = strtoull(separator + 1, NULL, 10);
+		}
+	}
+
+	free(line);
+	fclose(file);
+	return 0;
+}
+
+/**
+ * Write the known run times of all tests to a timings file, see
+ * `--save-timings`. Entries for tests that did not run in this invocation,
+ * e.g. because they belong to another shard, are carried over from the
+ * existing file.
+ */
+static void save_timings(const char *file_name) {
+	load_timings(file_name, 0);
+
+	size_t temporary_name_size = strlen(file_name) + sizeof(".tmp");
+	char *temporary_name = malloc(temporary_name_size);
+	snprintf(temporary_name, temporary_name_size, "%s.tmp", file_name);
+
+	FILE *file = fopen(temporary_name, "w");
+	if(!file) {
+		print_info(33, _CTESTER_INFO_WARNING, "Failed to write timings to %s: %s\n", temporary_name, strerror(errno));
+		free(temporary_name);
+		return;
+	}
+	for(struct ctester_test_case_list_t *test = ctester_tests; test < ctester_tests + ctester_number_of_tests; test++) {
+		if(test->expected_duration) {
+			fprintf(file, "%s\t%llu\n", test->full_test_name, test->expected_duration);
+		}
+	}
+	if(fclose(file) != 0 || rename(temporary_name, file_name) != 0) {
+		print_info(33, _CTESTER_INFO_WARNING, "Failed to write timings to %s: %s\n", file_name, strerror(errno));
+		unlink(temporary_name);
+	}
+	free(temporary_name);
+}
+
+/**
+ * Read the history of previous runs from a file with one line per test,
+ * holding its name, average run time in nanoseconds and `passed` or `failed`,
+ * separated by tabs.
+ *
+ * Returns -1 if the file cannot be read, e.g. before the first run.
+ */
+static int load_history(const char *file_name) {
+	history = calloc(ctester_number_of_tests ? ctester_number_of_tests : 1, sizeof(struct ctester_history_t));
+	FILE *file = fopen(file_name, "r");
+	if(!file) {
+		return -1;
+	}
+
+	char *line = NULL;
+	size_t line_size = 0;
+	while(getline(&line, &line_size, file) > 0) {
+		char *duration = strchr(line, '\t');
+		char *status = duration ? strchr(duration + 1, '\t') : NULL;
+		if(!status) {
+			continue;
+		}
+		*duration++ = 0;
+		*status++ = 0;
+		struct ctester_test_case_list_t *test = bsearch(line, ctester_tests, ctester_number_of_tests, sizeof(struct ctester_test_case_list_t), compare_test_to_name);
+		if(test) {
+			struct ctester_history_t *entry = &history[test - ctester_tests];
+			entry->known = 1;
+			entry->average_duration = strtoull(duration, NULL, 10);
+			entry->failed = strncmp(status, "failed", sizeof("failed") - 1) == 0;
+		}
+	}
+
+	free(line);
+	fclose(file);
+	return 0;
+}
+
+/**
+ * Record the outcome of a test in the history.
+ */
+static void update_history(struct ctester_test_case_list_t *test, int failed, unsigned long long duration) {
+	struct ctester_history_t *entry = &history[test - ctester_tests];
+	if(entry->known) {
+		entry->average_duration = (entry->average_duration * (100 - _CTESTER_HISTORY_WEIGHT) + duration * _CTESTER_HISTORY_WEIGHT) / 100;
+	}
+	else {
+		entry->average_duration = duration;
+	}
+	entry->failed = failed;
+	entry->known = 1;
+}
+
+/**
+ * Write the history back, see ::load_history.
+ *
+ * Entries of tests that no longer exist are dropped.
+ */
+static void save_history(const char *file_name) {
+	size_t temporary_name_size = strlen(file_name) + sizeof(".4294967295.tmp");
+	char *temporary_name = malloc(temporary_name_size);
+	snprintf(temporary_name, temporary_name_size, "%s.%d.tmp", file_name, (int)getpid());
+
+	FILE *file = fopen(temporary_name, "w");
+	if(!file) {
+		print_info(33, _CTESTER_INFO_WARNING, "Failed to write history to %s: %s\n", temporary_name, strerror(errno));
+		free(temporary_name);
+		return;
+	}
+	for(int i = 0; i < ctester_number_of_tests; i++) {
+		if(history[i].known) {
+			fprintf(file, "%s\t%llu\t%s\n", ctester_tests[i].full_test_name, history[i].average_duration, history[i].failed ? "failed" : "passed");
+		}
+	}
+	if(fclose(file) != 0 || rename(temporary_name, file_name) != 0) {
+		print_info(33, _CTESTER_INFO_WARNING, "Failed to write history to %s: %s\n", file_name, strerror(errno));
+		unlink(temporary_name);
+	}
+	free(temporary_name);
+}
+
+/**
+ * qsort(3) comparator for `--order failed-first`, putting the tests that
+ * failed in the previous run first and otherwise keeping the order by name.
+ */
+static int compare_failed_first(const void *a, const void *b) {
+	const struct ctester_test_case_list_t *x = *(struct ctester_test_case_list_t * const *)a, *y = *(struct ctester_test_case_list_t * const *)b;
+	int x_failed = history[x - ctester_tests].failed, y_failed = history[y - ctester_tests].failed;
+	if(x_failed != y_failed) {
+		return y_failed - x_failed;
+	}
+	return (x > y) - (x < y);
+}
+
+/**
+ * qsort(3) comparator for `--order slowest-first`, ordering tests by
+ * descending average run time in the history, and by name for equal times.
+ * Tests without history count as fast.
+ */
+static int compare_slowest_first(const void *a, const void *b) {
+	const struct ctester_test_case_list_t *x = *(struct ctester_test_case_list_t * const *)a, *y = *(struct ctester_test_case_list_t * const *)b;
+	unsigned long long x_duration = history[x - ctester_tests].average_duration, y_duration = history[y - ctester_tests].average_duration;
+	if(x_duration != y_duration) {
+		return (x_duration < y_duration) - (x_duration > y_duration);
+	}
+	return (x > y) - (x < y);
+}
+
+/**
+ * qsort(3) comparator ordering tests by descending expected duration, and by
+ * name for equal durations, such that all shards agree on the order.
+ */
+static int compare_expected_durations(const void *a, const void *b) {
+	const struct ctester_test_case_list_t *x = *(struct ctester_test_case_list_t * const *)a, *y = *(struct ctester_test_case_list_t * const *)b;
+	if(x->expected_duration != y->expected_duration) {
+		return (x->expected_duration < y->expected_duration) - (x->expected_duration > y->expected_duration);
+	}
+	return strcmp(x->full_test_name, y->full_test_name);
+}
+
+/**
+ * Unschedule all tests that belong to other shards than `--shard-index`.
+ *
+ * Without timings, tests are dealt out round-robin in the order of
+ * ::ctester_tests. With timings, the longest test is repeatedly assigned
+ * to the shard with the least expected work (longest processing time first),
+ * using the average duration for tests without timings. Either way, the
+ * assignment only depends on the selected tests, such that all shards agree
+ * on it.
+ */
+static void shard_tests(struct ctester_test_case_list_t **tests, int number_of_tests) {
+	if(!options.timings_file) {
+		for(int i = 0; i < number_of_tests; i++) {
+			if(i % options.total_shards != options.shard_index) {
+				tests[i]->state = _CTESTER_STATE_DEFAULT;
+			}
+		}
+		return;
+	}
+
+	unsigned long long known_duration = 0;
+	int number_of_known = 0;
+	for(int i = 0; i < number_of_tests; i++) {
+		if(tests[i]->expected_duration) {
+			known_duration += tests[i]->expected_duration;
+			number_of_known++;
+		}
+	}
+	unsigned long long default_duration = number_of_known ? known_duration / number_of_known : 1;
+	for(int i = 0; i < number_of_tests; i++) {
+		if(!tests[i]->expected_duration) {
+			tests[i]->expected_duration = default_duration;
+		}
+	}
+
+	qsort(tests, number_of_tests, sizeof(struct ctester_test_case_list_t *), compare_expected_durations);
+	unsigned long long *loads = calloc(options.total_shards, sizeof(unsigned long long));
+	for(int i = 0; i < number_of_tests; i++) {
+		int shard = 0;
+		for(int j = 1; j < options.total_shards; j++) {
+			if(loads[j] < loads[shard]) {
+				shard = j;
+			}
+		}
+		loads[shard] += tests[i]->expected_duration;
+		if(shard != options.shard_index) {
+			tests[i]->state = _CTESTER_STATE_DEFAULT;
+		}
+	}
+	free(loads);
+}
+
+/**
+ * Next value of the splitmix64 random number generator with the given state.
+ */
+static uint64_t random_next(uint64_t *state) {
+	uint64_t value = (*state += 0x9e3779b97f4a7c15ULL);
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+	return value ^ (value >> 31);
+}
+
+/**
+ * Shuffle the tests in `tests` randomly into `shuffled`, see `--shuffle`.
+ *
+ * The tests within each run of tests of the same test case are shuffled, and
+ * so is the order of these runs. Tests of a case thus stay together, and the
+ * ::SET_UP_TEST_CASE hooks run as often as without shuffling. The order only
+ * depends on `tests` and `seed`.
+ */
+static void shuffle_tests(struct ctester_test_case_list_t **tests, struct ctester_test_case_list_t **shuffled, int number_of_tests, uint64_t seed) {
+	int *run_starts = calloc(number_of_tests + 1, sizeof(int));
+	int number_of_runs = 0;
+	for(int i = 0; i < number_of_tests; i++) {
+		if(i == 0 || strcmp(tests[i]->test_case_name, tests[i - 1]->test_case_name)) {
+			run_starts[number_of_runs++] = i;
+		}
+	}
+	run_starts[number_of_runs] = number_of_tests;
+
+	int *run_order = calloc(number_of_runs ? number_of_runs : 1, sizeof(int));
+	for(int run = 0; run < number_of_runs; run++) {
+		run_order[run] = run;
+	}
+	for(int run = number_of_runs - 1; run > 0; run--) {
+		int other = random_next(&seed) % (run + 1);
+		int swap = run_order[run];
+		run_order[run] = run_order[other];
+		run_order[other] = swap;
+	}
+
+	int position = 0;
+	for(int run = 0; run < number_of_runs; run++) {
+		int start = run_starts[run_order[run]], length = run_starts[run_order[run] + 1] - start;
+		memcpy(shuffled + position, tests + start, length * sizeof(struct ctester_test_case_list_t *));
+		for(int i = length - 1; i > 0; i--) {
+			int other = random_next(&seed) % (i + 1);
+			struct ctester_test_case_list_t *swap = shuffled[position + i];
+			shuffled[position + i] = shuffled[position + other];
+			shuffled[position + other] = swap;
+		}
+		position += length;
+	}
+	free(run_order);
+	free(run_starts);
+}
+
+/**
+ * Account for a run of a test with `--repeat` or `--until-fail`.
+ */
+static void update_repeat_stats(struct ctester_test_case_list_t *test, struct ctester_test_result_t *result) {
+	struct ctester_repeat_stats_t *entry = &repeat_stats[test - ctester_tests];
+	if(result->failed) {
+		entry->failed++;
+	}
+	else {
+		entry->passed++;
+	}
+	// Welford's algorithm
+	unsigned runs = entry->passed + entry->failed;
+	double deviation = result->duration - entry->mean_duration;
+	entry->mean_duration += deviation / runs;
+	entry->squared_deviations += deviation * (result->duration - entry->mean_duration);
+}
+
+/**
+ * List how often each test passed and failed over all iterations, and how
+ * much its run time varied.
+ */
+static void print_repeat_stats() {
+	int number_of_tests = 0, flaky_tests = 0;
+	for(int i = 0; i < ctester_number_of_tests; i++) {
+		number_of_tests += repeat_stats[i].passed + repeat_stats[i].failed > 0;
+		flaky_tests += repeat_stats[i].passed > 0 && repeat_stats[i].failed > 0;
+	}
+	print_info(32, _CTESTER_INFO_THIN_BAR, "Outcome of %d test%s over all iterations, %d flaky:\n", number_of_tests, number_of_tests == 1 ? "" : "s", flaky_tests);
+	for(int i = 0; i < ctester_number_of_tests; i++) {
+		struct ctester_repeat_stats_t *entry = &repeat_stats[i];
+		unsigned runs = entry->passed + entry->failed;
+		if(!runs) {
+			continue;
+		}
+		char mean[32], stddev[32];
+		format_duration(mean, sizeof(mean), entry->mean_duration);
+		format_duration(stddev, sizeof(stddev), runs > 1 ? sqrt(entry->squared_deviations / (runs - 1)) : 0);
+		if(!entry->failed) {
+			print_info(32, _CTESTER_INFO_OK, "%s: passed %u of %u runs (%s mean, %s stddev)\n", ctester_tests[i].full_test_name, entry->passed, runs, mean, stddev);
+		}
+		else if(!entry->passed) {
+			print_info(31, _CTESTER_INFO_FAILED, "%s: failed %u of %u runs (%s mean, %s stddev)\n", ctester_tests[i].full_test_name, entry->failed, runs, mean, stddev);
+		}
+		else {
+			print_info(33, _CTESTER_INFO_FLAKY, "%s: failed %u of %u runs (%s mean, %s stddev)\n", ctester_tests[i].full_test_name, entry->failed, runs, mean, stddev);
+		}
+	}
+}
+
+// Characters of ::CTESTER_ANY_STRING, simplest first
+static const char property_alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~\t\n";
+
+/**
+ * Make the next choice of a property run, a number below `bound`, or any
+ * number if `bound` is 0.
+ *
+ * New choices are mostly small, such that small inputs and values close to
+ * zero are generated often.
+ */
+static uint64_t property_choice(struct ctester_property_run_t *run, uint64_t bound) {
+	uint64_t choice = 0;
+	if(run->position < run->number_of_choices) {
+		choice = run->choices[run->position];
+	}
+	else if(!run->replay) {
+		choice = random_next(&run->random);
+		choice >>= random_next(&run->random) % 64;
+		if(run->number_of_choices == run->capacity) {
+			run->capacity = run->capacity ? 2 * run->capacity : 64;
+			run->choices = realloc(run->choices, run->capacity * sizeof(uint64_t));
+			if(!run->choices) {
+				print_info(31, _CTESTER_INFO_FAILED, "Out of memory.\n");
+				exit(1);
+			}
+		}
+		run->choices[run->number_of_choices++] = bound ? choice % bound : choice;
+	}
+	run->position++;
+	return bound ? choice % bound : choice;
+}
+
+/**
+ * Allocate memory for an input of a property run, which is released by
+ * ::property_release.
+ */
+static void *property_alloc(struct ctester_property_run_t *run, size_t size) {
+	if(run->number_of_allocations == run->allocations_capacity) {
+		run->allocations_capacity = run->allocations_capacity ? 2 * run->allocations_capacity : 16;
+		run->allocations = realloc(run->allocations, run->allocations_capacity * sizeof(void *));
+	}
+	void *memory = malloc(size ? size : 1);
+	if(!run->allocations || !memory) {
+		print_info(31, _CTESTER_INFO_FAILED, "Out of memory.\n");
+		exit(1);
+	}
+	run->allocations[run->number_of_allocations++] = memory;
+	return memory;
+}
+
+/**
+ * Release the memory of the inputs of a property run.
+ */
+static void property_release(struct ctester_property_run_t *run) {
+	while(run->number_of_allocations) {
+		free(run->allocations[--run->number_of_allocations]);
+	}
+}
+
+/**
+ * Generate an integer from `min` to `max`.
+ *
+ * The choice orders the values by their distance from the one closest to
+ * zero, alternating between the sides while both have values left.
+ */
+static long long property_int(struct ctester_property_run_t *run, long long min, long long max) {
+	long long origin = min > 0 ? min : max < 0 ? max : 0;
+	uint64_t below = (uint64_t)origin - (uint64_t)min;
+	uint64_t above = (uint64_t)max - (uint64_t)origin;
+	// The full range of long long wraps around to a bound of 0, which means any choice
+	uint64_t choice = property_choice(run, below + above + 1);
+	uint64_t both_sides = below < above ? below : above;
+	if(choice <= 2 * both_sides) {
+		return choice & 1 ? (long long)((uint64_t)origin - (choice + 1) / 2) : (long long)((uint64_t)origin + choice / 2);
+	}
+	return above > below ? (long long)((uint64_t)origin + (choice - both_sides)) : (long long)((uint64_t)origin - (choice - both_sides));
+}
+
+/**
+ * Generate a double from `min` to `max`. The lowest bit of the choice picks
+ * the side of the value closest to zero, and the others the distance from it.
+ */
+static double property_double(struct ctester_property_run_t *run, double min, double max) {
+	double origin = min > 0 ? min : max < 0 ? max : 0;
+	uint64_t choice = property_choice(run, 0);
+	double fraction = (double)(choice >> 1) * 0x1p-63;
+	double value = origin + (choice & 1 ? min - origin : max - origin) * fraction;
+	return value < min ? min : value > max ? max : value;
+}
+
+/**
+ * Generate an input of a property run.
+ */
+static void property_generate(const struct ctester_arbitrary_t *arbitrary, struct ctester_property_run_t *run, struct ctester_property_value_t *value) {
+	memset(value, 0, sizeof(struct ctester_property_value_t));
+	if(arbitrary->kind == _CTESTER_ARBITRARY_INT) {
+		value->integer = property_int(run, arbitrary->min, arbitrary->max);
+		return;
+	}
+	if(arbitrary->kind == _CTESTER_ARBITRARY_DOUBLE) {
+		value->real = property_double(run, arbitrary->min_double, arbitrary->max_double);
+		return;
+	}
+	value->size = arbitrary->min_size + property_choice(run, arbitrary->max_size - arbitrary->min_size + 1);
+	if(arbitrary->kind == _CTESTER_ARBITRARY_BYTES) {
+		unsigned char *bytes = property_alloc(run, value->size);
+		for(size_t i = 0; i < value->size; i++) {
+			bytes[i] = property_choice(run, 256);
+		}
+		value->data = bytes;
+	}
+	else if(arbitrary->kind == _CTESTER_ARBITRARY_STRING) {
+		char *string = property_alloc(run, value->size + 1);
+		for(size_t i = 0; i < value->size; i++) {
+			string[i] = property_alphabet[property_choice(run, sizeof(property_alphabet) - 1)];
+		}
+		string[value->size] = 0;
+		value->data = string;
+	}
+	else if(arbitrary->element->kind == _CTESTER_ARBITRARY_INT) {
+		long long *integers = property_alloc(run, value->size * sizeof(long long));
+		for(size_t i = 0; i < value->size; i++) {
+			integers[i] = property_int(run, arbitrary->element->min, arbitrary->element->max);
+		}
+		value->data = integers;
+	}
+	else if(arbitrary->element->kind == _CTESTER_ARBITRARY_DOUBLE) {
+		double *doubles = property_alloc(run, value->size * sizeof(double));
+		for(size_t i = 0; i < value->size; i++) {
+			doubles[i] = property_double(run, arbitrary->element->min_double, arbitrary->element->max_double);
+		}
+		value->data = doubles;
+	}
+	else {
+		struct ctester_property_value_t *elements = property_alloc(run, value->size * sizeof(struct ctester_property_value_t));
+		for(size_t i = 0; i < value->size; i++) {
+			property_generate(arbitrary->element, run, &elements[i]);
+		}
+		value->data = elements;
+	}
+}
+
+/**
+ * Print an input of a property, abbreviating long ones.
+ */
+static void property_print_value(FILE *output, const struct ctester_arbitrary_t *arbitrary, const struct ctester_property_value_t *value) {
+	const size_t limit = 32;
+	if(arbitrary->kind == _CTESTER_ARBITRARY_INT) {
+		fprintf(output, "%lld", value->integer);
+	}
+	else if(arbitrary->kind == _CTESTER_ARBITRARY_DOUBLE) {
+		fprintf(output, "%.17g", value->real);
+	}
+	else if(arbitrary->kind == _CTESTER_ARBITRARY_BYTES) {
+		fprintf(output, "{");
+		for(size_t i = 0; i < value->size && i < limit; i++) {
+			fprintf(output, "%s0x%02x", i ? ", " : " ", ((const unsigned char *)value->data)[i]);
+		}
+		fprintf(output, "%s }", value->size > limit ? ", ..." : "");
+	}
+	else if(arbitrary->kind == _CTESTER_ARBITRARY_STRING) {
+		fputc('"', output);
+		for(const char *character = value->data; *character && character < (const char *)value->data + limit; character++) {
+			if(*character == '\n') {
+				fputs("\\n", output);
+			}
+			else if(*character == '\t') {
+				fputs("\\t", output);
+			}
+			else {
+				if(*character == '"' || *character == '\\') {
+					fputc('\\', output);
+				}
+				fputc(*character, output);
+			}
+		}
+		fprintf(output, "\"%s", value->size > limit ? "..." : "");
+	}
+	else {
+		fprintf(output, "{");
+		for(size_t i = 0; i < value->size && i < limit; i++) {
+			struct ctester_property_value_t element = { 0 };
+			if(arbitrary->element->kind == _CTESTER_ARBITRARY_INT) {
+				element.integer = ((const long long *)value->data)[i];
+			}
+			else if(arbitrary->element->kind == _CTESTER_ARBITRARY_DOUBLE) {
+				element.real = ((const double *)value->data)[i];
+			}
+			else {
+				element = ((const struct ctester_property_value_t *)value->data)[i];
+			}
+			fprintf(output, i ? ", " : " ");
+			property_print_value(output, arbitrary->element, &element);
+		}
+		fprintf(output, "%s }", value->size > limit ? ", ..." : "");
+	}
+	if(arbitrary->kind != _CTESTER_ARBITRARY_INT && arbitrary->kind != _CTESTER_ARBITRARY_DOUBLE && value->size > limit) {
+		fprintf(output, " (%zu in total)", value->size);
+	}
+}
+
+/**
+ * Generate the inputs of a property from the choices of `run` and run the
+ * property against them with `state`. Returns whether it failed.
+ */
+static int property_check(const struct ctester_property_t *property, struct ctester_property_run_t *run, struct ctester_property_value_t *values, struct ctester_test_case_state_t *state) {
+	run->position = 0;
+	for(size_t i = 0; i < property->count; i++) {
+		property_generate(property->arbitraries[i], run, &values[i]);
+	}
+	int failed = state->failed;
+	int warning = state->warning;
+	property->body(state, values);
+	property_release(run);
+	return state->failed != failed || state->warning != warning;
+}
+
+/**
+ * Replay `candidate` as the choices of a property run against a silent state.
+ * If the property still fails, the choices it used become the best ones.
+ */
+static int property_try(const struct ctester_property_t *property, struct ctester_property_run_t *run, struct ctester_property_value_t *values, FILE *silent_output,
+	const uint64_t *candidate, size_t candidate_size, uint64_t *best, size_t *best_size) {
+	memcpy(run->choices, candidate, candidate_size * sizeof(uint64_t));
+	run->number_of_choices = candidate_size;
+	struct ctester_test_case_state_t state;
+	memset(&state, 0, sizeof(struct ctester_test_case_state_t));
+	state.output = silent_output;
+	if(!property_check(property, run, values, &state)) {
+		return 0;
+	}
+	*best_size = run->position < candidate_size ? run->position : candidate_size;
+	memcpy(best, candidate, *best_size * sizeof(uint64_t));
+	return 1;
+}
+
+/**
+ * Shrink the failing choices `best` of a property run, by removing chunks of
+ * choices and by minimizing single ones, for as long as the property still
+ * fails. Returns the number of successful steps.
+ */
+static unsigned long property_shrink(const struct ctester_property_t *property, struct ctester_property_run_t *run, struct ctester_property_value_t *values, FILE *silent_output,
+	uint64_t *best, size_t *best_size) {
+	uint64_t *candidate = malloc((*best_size ? *best_size : 1) * sizeof(uint64_t));
+	if(!candidate) {
+		print_info(31, _CTESTER_INFO_FAILED, "Out of memory.\n");
+		exit(1);
+	}
+	run->replay = 1;
+	unsigned long steps = 0, attempts = 0;
+	for(int improved = 1; improved && attempts < _CTESTER_PROPERTY_MAX_SHRINK_ATTEMPTS;) {
+		improved = 0;
+
+		// Drop chunks of choices, e.g. elements of arrays, starting at the end
+		for(size_t chunk = 8; chunk > 0; chunk /= 2) {
+			for(size_t start = *best_size >= chunk ? *best_size - chunk + 1 : 0; start-- > 0 && attempts < _CTESTER_PROPERTY_MAX_SHRINK_ATTEMPTS;) {
+				if(start + chunk > *best_size) {
+					continue;
+				}
+				memcpy(candidate, best, start * sizeof(uint64_t));
+				memcpy(candidate + start, best + start + chunk, (*best_size - start - chunk) * sizeof(uint64_t));
+				attempts++;
+				if(property_try(property, run, values, silent_output, candidate, *best_size - chunk, best, best_size)) {
+					steps++;
+					improved = 1;
+				}
+			}
+		}
+
+		// Minimize each choice by a binary search, keeping its lowest bit,
+		// which picks the sign of numbers, and then clearing it
+		for(size_t i = 0; i < *best_size && attempts < _CTESTER_PROPERTY_MAX_SHRINK_ATTEMPTS; i++) {
+			if(!best[i]) {
+				continue;
+			}
+			uint64_t low_bit = best[i] & 1;
+			uint64_t low = 0, high = best[i] >> 1;
+			memcpy(candidate, best, *best_size * sizeof(uint64_t));
+			candidate[i] = 0;
+			attempts++;
+			if(property_try(property, run, values, silent_output, candidate, *best_size, best, best_size)) {
+				steps++;
+				improved = 1;
+				continue;
+			}
+			while(low < high && i < *best_size && attempts < _CTESTER_PROPERTY_MAX_SHRINK_ATTEMPTS) {
+				uint64_t middle = low + (high - low) / 2;
+				memcpy(candidate, best, *best_size * sizeof(uint64_t));
+				candidate[i] = middle << 1 | low_bit;
+				attempts++;
+				if(property_try(property, run, values, silent_output, candidate, *best_size, best, best_size)) {
+					steps++;
+					improved = 1;
+					high = middle;
+				}
+				else {
+					low = middle + 1;
+				}
+			}
+			for(int step = 0; step < 2 && i < *best_size && best[i] && attempts < _CTESTER_PROPERTY_MAX_SHRINK_ATTEMPTS; step++) {
+				memcpy(candidate, best, *best_size * sizeof(uint64_t));
+				candidate[i] = step == 0 ? best[i] & ~(uint64_t)1 : best[i] - 1;
+				if(candidate[i] == best[i]) {
+					continue;
+				}
+				attempts++;
+				if(property_try(property, run, values, silent_output, candidate, *best_size, best, best_size)) {
+					steps++;
+					improved = 1;
+				}
+			}
+		}
+	}
+	free(candidate);
+	return steps;
+}
+
+void _ctester_run_property(struct ctester_test_case_state_t *ctester_state, const struct ctester_property_t *property) {
+	// Each property draws its own inputs, such that they do not depend on which other tests run
+	uint64_t seed = options.property_seed;
+	for(const char *character = property->file; *character; character++) {
+		seed = (seed ^ (unsigned char)*character) * 0x100000001b3ULL;
+	}
+	seed ^= (uint64_t)property->line << 32;
+
+	struct ctester_property_run_t run;
+	memset(&run, 0, sizeof(struct ctester_property_run_t));
+	run.random = seed;
+	struct ctester_property_value_t *values = calloc(property->count ? property->count : 1, sizeof(struct ctester_property_value_t));
+	FILE *silent_output = fopen("/dev/null", "w");
+	if(!values || !silent_output) {
+		print_info(31, _CTESTER_INFO_FAILED, "Failed to prepare the property at %s:%d: %s\n", property->file, property->line, strerror(errno));
+		exit(1);
+	}
+
+	// Search for a failing input, silently, as its failures are reported once shrunk
+	unsigned long long start_time = get_clock_ns();
+	unsigned long cases = 0;
+	int failed = 0;
+	while(!failed && cases < options.property_runs) {
+		if(options.property_time_ms && cases > 0 && get_clock_ns() - start_time >= options.property_time_ms * 1000000ULL) {
+			break;
+		}
+		cases++;
+		run.number_of_choices = 0;
+		struct ctester_test_case_state_t state;
+		memset(&state, 0, sizeof(struct ctester_test_case_state_t));
+		state.output = silent_output;
+		failed = property_check(property, &run, values, &state);
+	}
+
+	if(failed) {
+		size_t best_size = run.number_of_choices;
+		uint64_t *best = malloc((best_size ? best_size : 1) * sizeof(uint64_t));
+		if(!best) {
+			print_info(31, _CTESTER_INFO_FAILED, "Out of memory.\n");
+			exit(1);
+		}
+		memcpy(best, run.choices, best_size * sizeof(uint64_t));
+		unsigned long steps = property_shrink(property, &run, values, silent_output, best, &best_size);
+
+		// Report the shrunk input, and run the property against it once more to report its failures
+		memcpy(run.choices, best, best_size * sizeof(uint64_t));
+		run.number_of_choices = best_size;
+		run.position = 0;
+		for(size_t i = 0; i < property->count; i++) {
+			property_generate(property->arbitraries[i], &run, &values[i]);
+		}
+		fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "%s:%d: Failure.\n", property->file, property->line);
+		fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "    Property failed after %lu input%s, reproduce with --property-seed %" PRIu64 ".\n", cases, cases == 1 ? "" : "s", options.property_seed);
+		fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "    Shrunk in %lu step%s to:\n", steps, steps == 1 ? "" : "s");
+		for(size_t i = 0; i < property->count; i++) {
+			fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "    #%zu = ", i);
+			property_print_value(_CTESTER_OUTPUT, property->arbitraries[i], &values[i]);
+			fprintf(_CTESTER_OUTPUT, "\n");
+		}
+		property_release(&run);
+		// A fatal failure within the property ends the property, not what wraps it
+		jmp_buf *fatal_jump = ctester_state->fatal_jump;
+		ctester_state->fatal_jump = NULL;
+		if(!property_check(property, &run, values, ctester_state)) {
+			fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "    It passed when run again, the property is not deterministic.\n");
+		}
+		ctester_state->fatal_jump = fatal_jump;
+		free(best);
+	}
+
+	fclose(silent_output);
+	free(values);
+	free(run.choices);
+	free(run.allocations);
+	if(failed) {
+		_ctester_fatal_failure(ctester_state, property->line);
+	}
+}
+
+/**
+ * Body of a thread of a ::TEST_THREADS.
+ */
+static void *thread_main(void *argument) {
+	struct ctester_thread_t *thread = argument;
+	pthread_barrier_wait(thread->barrier);
+	thread->threads->loop(&thread->state, thread->index, thread->number_of_threads, thread->stop, &thread->operations);
+	__atomic_add_fetch(thread->finished, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/**
+ * Run a round of a ::TEST_THREADS on `number_of_threads` threads, pinned to
+ * the CPUs in `cpus`, for `--threads-time-ms`. Stores the time the threads
+ * ran in `run_time`.
+ *
+ * The failures of each thread are printed along with its index and merged
+ * into `ctester_state`, except for fatal ones, whose line is stored in
+ * `fatal_line`. Returns whether a thread failed.
+ */
+static int threads_round(struct ctester_test_case_state_t *ctester_state, const struct ctester_threads_t *threads, struct ctester_thread_t *thread_list, int number_of_threads,
+	const int *cpus, int number_of_cpus, unsigned long long *run_time, int *fatal_line) {
+	pthread_barrier_t barrier;
+	int stop = 0, finished = 0;
+	pthread_barrier_init(&barrier, NULL, number_of_threads + 1);
+	for(int i = 0; i < number_of_threads; i++) {
+		struct ctester_thread_t *thread = &thread_list[i];
+		memset(thread, 0, sizeof(struct ctester_thread_t));
+		thread->threads = threads;
+		thread->index = i;
+		thread->number_of_threads = number_of_threads;
+		thread->barrier = &barrier;
+		thread->stop = &stop;
+		thread->finished = &finished;
+		thread->state.output = open_memstream(&thread->output, &thread->output_size);
+		pthread_attr_t attributes;
+		pthread_attr_init(&attributes);
+		if(number_of_cpus > 0) {
+			cpu_set_t cpu;
+			CPU_ZERO(&cpu);
+			CPU_SET(cpus[i % number_of_cpus], &cpu);
+			pthread_attr_setaffinity_np(&attributes, sizeof(cpu_set_t), &cpu);
+		}
+		int error = thread->state.output ? pthread_create(&thread->thread, &attributes, thread_main, thread) : errno;
+		pthread_attr_destroy(&attributes);
+		if(error) {
+			print_info(31, _CTESTER_INFO_FAILED, "Failed to start thread %d of %s: %s\n", i, threads->full_test_name, strerror(error));
+			exit(1);
+		}
+	}
+
+	pthread_barrier_wait(&barrier);
+	unsigned long long start_time = get_clock_ns();
+	// Threads stop early at their first failure
+	while(get_clock_ns() - start_time < options.threads_time_ms * 1000000ULL && __atomic_load_n(&finished, __ATOMIC_ACQUIRE) < number_of_threads) {
+		struct timespec interval = { 0, 1000000 };
+		nanosleep(&interval, NULL);
+	}
+	__atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+	for(int i = 0; i < number_of_threads; i++) {
+		pthread_join(thread_list[i].thread, NULL);
+	}
+	*run_time = get_clock_ns() - start_time;
+	pthread_barrier_destroy(&barrier);
+
+	int failed = 0;
+	for(int i = 0; i < number_of_threads; i++) {
+		struct ctester_thread_t *thread = &thread_list[i];
+		fclose(thread->state.output);
+		if(thread->state.failed || thread->state.warning) {
+			failed = 1;
+			flockfile(_CTESTER_OUTPUT);
+			fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "Thread %d of %d failed:\n", i, number_of_threads);
+			fwrite(thread->output, 1, thread->output_size, _CTESTER_OUTPUT);
+			funlockfile(_CTESTER_OUTPUT);
+			__atomic_add_fetch(&ctester_state->warning, thread->state.warning, __ATOMIC_RELAXED);
+			if(thread->state.failed && !*fatal_line) {
+				*fatal_line = thread->state.failed;
+			}
+		}
+		free(thread->output);
+	}
+	return failed;
+}
+
+void _ctester_run_threads(struct ctester_test_case_state_t *ctester_state, const struct ctester_threads_t *threads) {
+	// The allocations of the harness are not the test's, those of the threads are
+	_ctester_alloc_untracked = 1;
+	int maximum = threads->number_of_threads > 0 ? threads->number_of_threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(maximum < 1) {
+		maximum = 1;
+	}
+
+	// Threads are pinned to distinct CPUs among those this process may run on, as long as there are enough
+	cpu_set_t allowed;
+	int cpus[CPU_SETSIZE];
+	int number_of_cpus = 0;
+	if(sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == 0) {
+		for(int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if(CPU_ISSET(cpu, &allowed)) {
+				cpus[number_of_cpus++] = cpu;
+			}
+		}
+	}
+
+	struct ctester_thread_t *thread_list = calloc(maximum, sizeof(struct ctester_thread_t));
+	if(!thread_list) {
+		print_info(31, _CTESTER_INFO_FAILED, "Out of memory.\n");
+		exit(1);
+	}
+	double single_thread_rate = 0;
+	int fatal_line = 0;
+	for(int number_of_threads = 1;; number_of_threads = 2 * number_of_threads < maximum ? 2 * number_of_threads : maximum) {
+		unsigned long long run_time;
+		if(threads_round(ctester_state, threads, thread_list, number_of_threads, cpus, number_of_cpus, &run_time, &fatal_line)) {
+			break;
+		}
+
+		double rate = 0, min_rate = 0, max_rate = 0;
+		for(int i = 0; i < number_of_threads; i++) {
+			double thread_rate = thread_list[i].operations * 1e9 / (run_time ? run_time : 1);
+			rate += thread_rate;
+			min_rate = i == 0 || thread_rate < min_rate ? thread_rate : min_rate;
+			max_rate = i == 0 || thread_rate > max_rate ? thread_rate : max_rate;
+		}
+		if(number_of_threads == 1) {
+			single_thread_rate = rate;
+		}
+		char rate_buffer[32], per_thread_buffer[32], min_buffer[32], max_buffer[32];
+		print_info(32, _CTESTER_INFO_SCALE, "%s: %d thread%s, %s, %s per thread (%s to %s), %.2fx of 1 thread\n", threads->full_test_name,
+			number_of_threads, number_of_threads == 1 ? "" : "s", format_rate(rate_buffer, sizeof(rate_buffer), rate),
+			format_rate(per_thread_buffer, sizeof(per_thread_buffer), rate / number_of_threads), format_rate(min_buffer, sizeof(min_buffer), min_rate),
+			format_rate(max_buffer, sizeof(max_buffer), max_rate), single_thread_rate > 0 ? rate / single_thread_rate : 0.);
+		if(number_of_threads == maximum) {
+			break;
+		}
+	}
+	free(thread_list);
+	_ctester_alloc_untracked = 0;
+	if(fatal_line) {
+		_ctester_fatal_failure(ctester_state, fatal_line);
+	}
+}
+
+/**
+ * Summarize the outcome of a test in one word, for the reports.
+ */
+static const char *reporter_status(struct ctester_test_result_t *result) {
+	if(result->failed == 0) {
+		return "passed";
+	}
+	if(result->timed_out) {
+		return "timed_out";
+	}
+	return result->failed < 0 ? "crashed" : "failed";
+}
 
-struct ctester_test_case_list_t *ctester_test_root;
+/**
+ * Escape `size` bytes of `string` for use in a JSON string.
+ */
+static void json_write_string(FILE *file, const char *string, size_t size) {
+	fputc('"', file);
+	for(size_t i = 0; i < size; i++) {
+		unsigned char character = string[i];
+		switch(character) {
+			case '"':  fputs("\\\"", file); break;
+			case '\\': fputs("\\\\", file); break;
+			case '\n': fputs("\\n", file); break;
+			case '\r': fputs("\\r", file); break;
+			case '\t': fputs("\\t", file); break;
+			default:
+				if(character < 0x20) {
+					fprintf(file, "\\u%04x", character);
+				}
+				else {
+					fputc(character, file);
+				}
+		}
+	}
+	fputc('"', file);
+}
 
 /**
- * printf(), but output `info` in ANSI color code `color` preceding the normal
- * output.
+ * Escape `size` bytes of `string` for use in XML text or attributes.
+ *
+ * Control characters cannot be represented in XML 1.0 and are replaced by `?`.
  */
-static void print_info(int color, char *info, char *format, ...) {
-	static int fp_1_is_tty = -1;
+static void xml_write_string(FILE *file, const char *string, size_t size) {
+	for(size_t i = 0; i < size; i++) {
+		unsigned char character = string[i];
+		switch(character) {
+			case '&': fputs("&amp;", file); break;
+			case '<': fputs("&lt;", file); break;
+			case '>': fputs("&gt;", file); break;
+			case '"': fputs("&quot;", file); break;
+			case '\n':
+			case '\r':
+			case '\t':
+				fputc(character, file);
+				break;
+			default:
+				fputc(character < 0x20 ? '?' : character, file);
+		}
+	}
+}
 
-	if(fp_1_is_tty < 0) {
-		fp_1_is_tty = isatty(1);
+/**
+ * Start a JSON report: an object with a `tests` array, followed by the
+ * summary counts.
+ */
+static void json_begin(struct ctester_reporter_t *reporter) {
+	fputs("{\"tests\":[", reporter->file);
+}
+
+/**
+ * Append a test to a JSON report.
+ */
+static void json_test_end(struct ctester_reporter_t *reporter, struct ctester_test_case_list_t *test, struct ctester_test_result_t *result, struct ctester_benchmark_stats_t *stats, const char *message) {
+	FILE *file = reporter->file;
+	fputs(reporter->number_of_tests ? ",\n" : "\n", file);
+	fputs("{\"name\":", file);
+	json_write_string(file, test->test_name, strlen(test->test_name));
+	fputs(",\"case\":", file);
+	json_write_string(file, test->test_case_name, strlen(test->test_case_name));
+	fputs(",\"full_name\":", file);
+	json_write_string(file, test->full_test_name, strlen(test->full_test_name));
+	fprintf(file, ",\"status\":\"%s\",\"warnings\":%d", reporter_status(result), result->warning);
+	if(result->failed > 0) {
+		fprintf(file, ",\"failed_line\":%d", result->failed);
+	}
+	fprintf(file, ",\"duration_ns\":%llu,\"body_duration_ns\":%llu", result->duration, result->body_duration);
+	if(result->has_usage) {
+		fprintf(file, ",\"user_time_us\":%ld,\"system_time_us\":%ld,\"max_rss_kib\":%ld",
+			result->usage.ru_utime.tv_sec * 1000000L + result->usage.ru_utime.tv_usec,
+			result->usage.ru_stime.tv_sec * 1000000L + result->usage.ru_stime.tv_usec,
+			result->usage.ru_maxrss);
+	}
+	if(result->has_allocs) {
+		fprintf(file, ",\"allocations\":%llu,\"allocated_bytes\":%llu,\"peak_live_bytes\":%lld,\"leaked_bytes\":%lld",
+			result->allocs.allocations, result->allocs.bytes, result->allocs.peak_live_bytes, result->allocs.live_bytes > 0 ? result->allocs.live_bytes : 0);
+	}
+	if(result->counters_mask) {
+		fputs(",\"counters\":{", file);
+		for(int i = 0, first = 1; i < _CTESTER_NUMBER_OF_COUNTERS; i++) {
+			if(result->counters_mask & (1U << i)) {
+				fprintf(file, "%s\"%s\":%llu", first ? "" : ",", counter_events[i].name, result->counters[i]);
+				first = 0;
+			}
+		}
+		fputc('}', file);
+	}
+	if(stats) {
+		fprintf(file, ",\"benchmark\":{\"mean_ns\":%.3f,\"median_ns\":%.3f,\"stddev_ns\":%.3f,\"min_ns\":%.3f,\"p99_ns\":%.3f,\"samples\":%d,\"iterations\":%lu}",
+			stats->mean, stats->median, stats->stddev, stats->min, stats->p99, _CTESTER_BENCHMARK_SAMPLES, stats->iterations);
 	}
+	if(message) {
+		fputs(",\"message\":", file);
+		json_write_string(file, message, strlen(message));
+	}
+	if(result->output_size) {
+		fputs(",\"output\":", file);
+		json_write_string(file, result->output, result->output_size);
+	}
+	fputc('}', file);
+}
 
-	va_list args;
-	va_start(args, format);
+/**
+ * Close the `tests` array of a JSON report and add the summary.
+ */
+static void json_end(struct ctester_reporter_t *reporter, unsigned passed_tests, unsigned failed_tests, unsigned disabled_tests, unsigned long long duration) {
+	fprintf(reporter->file, "\n],\"passed\":%u,\"failed\":%u,\"disabled\":%u,\"duration_ns\":%llu}\n", passed_tests, failed_tests, disabled_tests, duration);
+}
 
-	if(fp_1_is_tty) {
-		printf("\033[%dm[%s]\033[0m ", color, info);
+/**
+ * Text that makes a partial JSON report valid.
+ */
+static const char *json_tail(struct ctester_reporter_t *reporter __attribute__((unused))) {
+	return "\n]}\n";
+}
+
+/**
+ * Start a JUnit XML report.
+ */
+static void junit_begin(struct ctester_reporter_t *reporter) {
+	fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n", reporter->file);
+}
+
+/**
+ * Open a `<testsuite>` element for a test case.
+ */
+static void junit_test_case_begin(struct ctester_reporter_t *reporter, const char *test_case_name, int number_of_tests) {
+	fputs("<testsuite name=\"", reporter->file);
+	xml_write_string(reporter->file, test_case_name, strlen(test_case_name));
+	fprintf(reporter->file, "\" tests=\"%d\">\n", number_of_tests);
+}
+
+/**
+ * Append a `<testcase>` element for a test.
+ */
+static void junit_test_end(struct ctester_reporter_t *reporter, struct ctester_test_case_list_t *test, struct ctester_test_result_t *result, struct ctester_benchmark_stats_t *stats, const char *message) {
+	FILE *file = reporter->file;
+	fputs("<testcase name=\"", file);
+	xml_write_string(file, test->test_name, strlen(test->test_name));
+	fputs("\" classname=\"", file);
+	xml_write_string(file, test->test_case_name, strlen(test->test_case_name));
+	fprintf(file, "\" time=\"%.9f\">\n", result->duration / 1e9);
+	if(result->warning || stats) {
+		fputs("<properties>\n", file);
+		fprintf(file, "<property name=\"warnings\" value=\"%d\"/>\n", result->warning);
+		if(stats) {
+			fprintf(file, "<property name=\"mean_ns\" value=\"%.3f\"/>\n<property name=\"median_ns\" value=\"%.3f\"/>\n", stats->mean, stats->median);
+		}
+		fputs("</properties>\n", file);
+	}
+	if(result->failed != 0) {
+		fprintf(file, "<failure type=\"%s\" message=\"", reporter_status(result));
+		if(message) {
+			xml_write_string(file, message, strlen(message));
+		}
+		else {
+			fprintf(file, "Failed at line %d with %d warning%s", result->failed, result->warning, result->warning == 1 ? "" : "s");
+		}
+		fputs("\">", file);
+		xml_write_string(file, result->output ? result->output : "", result->output_size);
+		fputs("</failure>\n", file);
+	}
+	else if(result->output_size) {
+		fputs("<system-err>", file);
+		xml_write_string(file, result->output, result->output_size);
+		fputs("</system-err>\n", file);
+	}
+	fputs("</testcase>\n", file);
+}
+
+/**
+ * Close the `<testsuite>` element of a test case.
+ */
+static void junit_test_case_end(struct ctester_reporter_t *reporter) {
+	fputs("</testsuite>\n", reporter->file);
+}
+
+/**
+ * Finish a JUnit XML report.
+ */
+static void junit_end(struct ctester_reporter_t *reporter, unsigned passed_tests __attribute__((unused)), unsigned failed_tests __attribute__((unused)), unsigned disabled_tests __attribute__((unused)), unsigned long long duration __attribute__((unused))) {
+	fputs("</testsuites>\n", reporter->file);
+}
+
+/**
+ * Text that makes a partial JUnit XML report well-formed.
+ */
+static const char *junit_tail(struct ctester_reporter_t *reporter) {
+	return reporter->in_test_case ? "</testsuite>\n</testsuites>\n" : "</testsuites>\n";
+}
+
+/**
+ * The available report formats, see `--output`.
+ */
+static const struct ctester_reporter_type_t reporter_types[] = {
+	{ "json", json_begin, NULL, json_test_end, NULL, json_end, json_tail },
+	{ "junit", junit_begin, junit_test_case_begin, junit_test_end, junit_test_case_end, junit_end, junit_tail },
+};
+
+/**
+ * Parse a `--output=FORMAT:FILE` argument and open the report.
+ */
+static void reporter_add(const char *argument) {
+	const char *colon = strchr(argument, ':');
+	const struct ctester_reporter_type_t *type = NULL;
+	for(size_t i = 0; colon && i < sizeof(reporter_types) / sizeof(reporter_types[0]); i++) {
+		if(strlen(reporter_types[i].name) == (size_t)(colon - argument) && strncmp(reporter_types[i].name, argument, colon - argument) == 0) {
+			type = &reporter_types[i];
+		}
+	}
+	if(!type) {
+		print_info(31, _CTESTER_INFO_FAILED, "Invalid output %s, expected json:FILE or junit:FILE.\n", argument);
+		exit(1);
+	}
+	FILE *file = fopen(colon + 1, "w");
+	if(!file) {
+		print_info(31, _CTESTER_INFO_FAILED, "Failed to open %s: %s\n", colon + 1, strerror(errno));
+		exit(1);
+	}
+
+	reporters = realloc(reporters, (number_of_reporters + 1) * sizeof(struct ctester_reporter_t));
+	struct ctester_reporter_t *reporter = &reporters[number_of_reporters++];
+	memset(reporter, 0, sizeof(struct ctester_reporter_t));
+	reporter->type = type;
+	reporter->file = file;
+	reporter->seekable = ftell(file) >= 0;
+}
+
+/**
+ * Write the closing text of a report and flush it, such that the report on
+ * disk is complete at all times. The position is reset to the start of the
+ * closing text, for the next entry to overwrite it.
+ */
+static void reporter_commit(struct ctester_reporter_t *reporter) {
+	if(reporter->seekable) {
+		long position = ftell(reporter->file);
+		fputs(reporter->type->tail(reporter), reporter->file);
+		fflush(reporter->file);
+		fseek(reporter->file, position, SEEK_SET);
 	}
 	else {
-		printf("[%s] ", info);
+		fflush(reporter->file);
 	}
-	vprintf(format, args);
 }
 
 /**
- * Return number of wall-clock miliseconds since some fixed date. Only deltas
- * of the returned value are used.
+ * Start all reports.
  */
-static unsigned long get_clock_ms() {
-	struct timespec tp;
-	if(clock_gettime(CLOCK_MONOTONIC, &tp) == -1) {
-		print_info(33, _CTESTER_INFO_WARNING, "Failed to retrieve value of monotonic clock. Timing info will be wrong.\n");
-		return 0;
+static void reporters_begin() {
+	for(int i = 0; i < number_of_reporters; i++) {
+		reporters[i].type->begin(&reporters[i]);
+		reporter_commit(&reporters[i]);
+	}
+}
+
+/**
+ * Announce a new test case to all reports.
+ */
+static void reporters_test_case_begin(const char *test_case_name, int number_of_tests) {
+	for(int i = 0; i < number_of_reporters; i++) {
+		if(reporters[i].type->test_case_begin) {
+			reporters[i].type->test_case_begin(&reporters[i], test_case_name, number_of_tests);
+		}
+		reporters[i].in_test_case = 1;
+	}
+}
+
+/**
+ * Append the result of a test to all reports.
+ */
+static void reporters_test_end(struct ctester_test_case_list_t *test, struct ctester_test_result_t *result, struct ctester_benchmark_stats_t *stats, const char *message) {
+	for(int i = 0; i < number_of_reporters; i++) {
+		reporters[i].type->test_end(&reporters[i], test, result, stats, message);
+		reporters[i].number_of_tests++;
+		reporter_commit(&reporters[i]);
+	}
+}
+
+/**
+ * Announce the end of a test case to all reports.
+ */
+static void reporters_test_case_end() {
+	for(int i = 0; i < number_of_reporters; i++) {
+		if(reporters[i].type->test_case_end) {
+			reporters[i].type->test_case_end(&reporters[i]);
+		}
+		reporters[i].in_test_case = 0;
+	}
+}
+
+/**
+ * Finish and close all reports.
+ */
+static void reporters_end(unsigned passed_tests, unsigned failed_tests, unsigned disabled_tests, unsigned long long duration) {
+	for(int i = 0; i < number_of_reporters; i++) {
+		reporters[i].type->end(&reporters[i], passed_tests, failed_tests, disabled_tests, duration);
+		fflush(reporters[i].file);
+		if(reporters[i].seekable && ftruncate(fileno(reporters[i].file), ftell(reporters[i].file)) < 0) {
+			print_info(33, _CTESTER_INFO_WARNING, "Failed to truncate a report: %s\n", strerror(errno));
+		}
+		fclose(reporters[i].file);
 	}
-	return tp.tv_sec * 1000 + tp.tv_nsec / 1000000;
+	free(reporters);
+	reporters = NULL;
+	number_of_reporters = 0;
 }
 
 /**
@@ -81,13 +4384,118 @@ static unsigned long get_clock_ms() {
  */
 void print_help(const char *binary_name) {
 	puts("This binary contains ctester test cases.\n\nSyntax:\n");
-	printf(" %s [-h] [-l] [-t <pattern>]\n", binary_name);
+	printf(" %s [-h] [-l] [-t <pattern>] [-j <workers>] [--isolate] [--max-rss <MiB>]\n"
+		"    [--max-address-space <MiB>] [--max-cpu <seconds>]\n"
+		"    [--bench] [--bench-time <ms>] [--slowest <n>] [--timeout-ms <ms>] [--deadline <s>]\n"
+		"    [--shard-index <i> --total-shards <n>] [--timings <file>] [--save-timings <file>]\n"
+		"    [--capture | --no-capture] [--output-on-failure]\n"
+		"    [--output json:<file>] [--output junit:<file>]\n"
+		"    [--history <file> | --no-history] [--order <order>] [--last-failed]\n"
+		"    [--death-test-style <style>] [--counters <counters>]\n"
+		"    [--repeat <n>] [--until-fail] [--shuffle] [--seed <seed>]\n"
+		"    [--property-runs <n>] [--property-time-ms <ms>] [--property-seed <seed>]\n"
+		"    [--threads-time-ms <ms>] [--update-golden]\n"
+		"    [<module>...]\n", binary_name);
 	puts("\n"
 		"Where\n"
 		"  -h               Prints this help.\n"
-		"  -l               Lists available test cases.\n"
+		"  -l               Lists available test cases, or benchmarks with --bench.\n"
 		"  -t <pattern>     Specifies a fnmatch(3) pattern to specify which test\n"
 		"                   cases to run.\n"
+		"  -j <workers>     Runs tests in parallel on a pool of forked worker\n"
+		"                   processes. 0 uses one worker per online CPU.\n"
+		"  --isolate        Runs each test in a child process of its own and\n"
+		"                   reports its resource usage. Tests that crash are\n"
+		"                   reported as failed instead of aborting the run.\n"
+		"  --max-rss <MiB>  Fails isolated tests whose resident memory exceeded\n"
+		"                   this, once they finished. Implies --isolate.\n"
+		"  --max-address-space <MiB>\n"
+		"                   Limits the address space of isolated tests, such\n"
+		"                   that allocations beyond it fail. This includes\n"
+		"                   reserved memory like thread stacks. Implies\n"
+		"                   --isolate.\n"
+		"  --max-cpu <sec>  Kills isolated tests that use more CPU time. Implies\n"
+		"                   --isolate.\n"
+		"  --bench          Runs the benchmarks instead of the tests. -t selects\n"
+		"                   benchmarks just like tests.\n"
+		"  --bench-time <ms>\n"
+		"                   Target run time per benchmark, defaults to 500.\n"
+		"  --slowest <n>    Lists the n tests that took longest after the run.\n"
+		"  --timeout-ms <ms>\n"
+		"                   Fails tests, and kills ASSERT_DEATH/ASSERT_EXIT children,\n"
+		"                   that take longer. A test hanging in the main process\n"
+		"                   aborts the run, use --isolate or -j to continue.\n"
+		"  --deadline <s>   Aborts the whole run after this many seconds.\n"
+		"  --shard-index <i>, --total-shards <n>\n"
+		"                   Splits the selected tests into n shards and runs shard\n"
+		"                   i (counting from 0). Defaults to the GTEST_SHARD_INDEX\n"
+		"                   and GTEST_TOTAL_SHARDS environment variables.\n"
+		"  --timings <file> Balances shards by the run times stored in file\n"
+		"                   instead of by the number of tests.\n"
+		"  --save-timings <file>\n"
+		"                   Stores the run times of this run in file, for use\n"
+		"                   with --timings.\n"
+		"  --capture, --no-capture\n"
+		"                   Collects the output of each test in memory and prints\n"
+		"                   it in one go after the test. This is the default with\n"
+		"                   -j and --isolate.\n"
+		"  --output-on-failure\n"
+		"                   Only prints the captured output of failed tests.\n"
+		"                   Implies --capture.\n"
+		"  --history <file>\n"
+		"                   Records the outcome and average run time of each test\n"
+		"                   in file. Defaults to the name of the binary followed by\n"
+		"                   .history.\n"
+		"  --no-history     Neither reads nor writes the history.\n"
+		"  --order <order>  Runs tests in the given order, based on the history:\n"
+		"                   name (the default), failed-first, or slowest-first,\n"
+		"                   which also balances -j best.\n"
+		"  --last-failed    Only runs the tests that failed in the previous run, or\n"
+		"                   all tests if none failed.\n"
+		"  --repeat <n>     Runs the selected tests n times in one process, and\n"
+		"                   lists how often each test passed and failed.\n"
+		"  --until-fail     Repeats the tests until an iteration fails, at most\n"
+		"                   --repeat times if given.\n"
+		"  --shuffle        Runs the test cases, and the tests within each case,\n"
+		"                   in random order. The seed of each iteration is\n"
+		"                   printed.\n"
+		"  --seed <seed>    Seed for --shuffle, to reproduce an order. Implies\n"
+		"                   --shuffle.\n"
+		"  --property-runs <n>\n"
+		"                   Runs each PROPERTY against up to n random inputs,\n"
+		"                   defaults to 1000.\n"
+		"  --property-time-ms <ms>\n"
+		"                   Stops generating inputs for a PROPERTY after this\n"
+		"                   time, even if fewer than --property-runs ran.\n"
+		"  --property-seed <seed>\n"
+		"                   Seed of the inputs of properties, to reproduce a\n"
+		"                   failure. It is printed along with failing inputs.\n"
+		"  --threads-time-ms <ms>\n"
+		"                   Run time of each number of threads a TEST_THREADS\n"
+		"                   runs on, defaults to 100.\n"
+		"  --update-golden  Replaces golden files that do not match the buffers of\n"
+		"                   ASSERT_MATCHES_GOLDEN by them instead of failing.\n"
+		"  --death-test-style <style>\n"
+		"                   How ASSERT_DEATH runs its statement: fork (the\n"
+		"                   default), or vfork, which is much faster for big\n"
+		"                   processes, but shares the memory of the test with\n"
+		"                   the statement. It is only safe for statements that\n"
+		"                   crash or return using async-signal-safe functions,\n"
+		"                   e.g. not malloc(3), exit(3) or buffered stdio.\n"
+		"  --counters <counters>\n"
+		"                   Counts events with perf_event_open(2) while each test\n"
+		"                   runs, given as a comma separated list of instructions,\n"
+		"                   cycles, cache-misses, branch-misses, task-clock,\n"
+		"                   page-faults and context-switches. Falls back to the\n"
+		"                   software events if hardware counters are not\n"
+		"                   available.\n"
+		"  --output json:<file>, --output junit:<file>\n"
+		"                   Writes a report in JSON or JUnit XML format to file,\n"
+		"                   updated after each test. Implies --capture, unless\n"
+		"                   --no-capture is given.\n"
+		"  <module>...      Shared objects of tests to load, see ctester-module.c.\n"
+		"                   Their tests run along with those of this binary, as\n"
+		"                   if they were linked into it.\n"
 		"\n"
 	);
 }
@@ -96,30 +4504,205 @@ void print_help(const char *binary_name) {
  * List all available test cases.
  */
 void print_list() {
-	struct ctester_test_case_list_t *test = ctester_test_root;
-	while(test) {
-		printf("%s\n", test->full_test_name);
-		test = test->next;
+	for(struct ctester_test_case_list_t *test = ctester_tests; test < ctester_tests + ctester_number_of_tests; test++) {
+		if((test->benchmark_body != NULL) == options.bench) {
+			printf("%s\n", test->full_test_name);
+		}
 	}
 }
 
 int main(int argc, char *argv[]) {
 	// Command line parsing
 	const char *pattern = "*";
+	int number_of_workers = 1;
+	int list = 0;
+	int no_history = 0;
+	if(getenv("GTEST_SHARD_INDEX") && getenv("GTEST_TOTAL_SHARDS")) {
+		options.shard_index = atoi(getenv("GTEST_SHARD_INDEX"));
+		options.total_shards = atoi(getenv("GTEST_TOTAL_SHARDS"));
+	}
+	static struct option long_options[] = {
+		{ "isolate", no_argument, NULL, 'I' },
+		{ "max-rss", required_argument, NULL, 'M' },
+		{ "max-address-space", required_argument, NULL, 'A' },
+		{ "max-cpu", required_argument, NULL, 'C' },
+		{ "bench", no_argument, NULL, 'B' },
+		{ "bench-time", required_argument, NULL, 'T' },
+		{ "slowest", required_argument, NULL, 'S' },
+		{ "timeout-ms", required_argument, NULL, 'W' },
+		{ "deadline", required_argument, NULL, 'D' },
+		{ "shard-index", required_argument, NULL, 'i' },
+		{ "total-shards", required_argument, NULL, 'n' },
+		{ "timings", required_argument, NULL, 'r' },
+		{ "save-timings", required_argument, NULL, 'w' },
+		{ "capture", no_argument, &options.capture, 1 },
+		{ "no-capture", no_argument, &options.capture, 0 },
+		{ "output-on-failure", no_argument, NULL, 'F' },
+		{ "output", required_argument, NULL, 'O' },
+		{ "history", required_argument, NULL, 'H' },
+		{ "no-history", no_argument, NULL, 'N' },
+		{ "order", required_argument, NULL, 'o' },
+		{ "last-failed", no_argument, &options.last_failed, 1 },
+		{ "death-test-style", required_argument, NULL, 'd' },
+		{ "counters", required_argument, NULL, 'P' },
+		{ "repeat", required_argument, NULL, 'R' },
+		{ "until-fail", no_argument, &options.until_fail, 1 },
+		{ "shuffle", no_argument, &options.shuffle, 1 },
+		{ "seed", required_argument, NULL, 'e' },
+		{ "property-runs", required_argument, NULL, 'p' },
+		{ "property-time-ms", required_argument, NULL, 'm' },
+		{ "property-seed", required_argument, NULL, 's' },
+		{ "threads-time-ms", required_argument, NULL, 'a' },
+		{ "update-golden", no_argument, &options.update_golden, 1 },
+		{ NULL, 0, NULL, 0 }
+	};
 	int character;
-	while((character = getopt(argc, argv, "hlt:")) != -1) {
+	while((character = getopt_long(argc, argv, "hlt:j:", long_options, NULL)) != -1) {
 		switch(character) {
 			case 'h':
 				print_help(argv[0]);
 				exit(0);
 				break;
 			case 'l':
-				print_list();
-				exit(0);
+				list = 1;
 				break;
 			case 't':
 				pattern = strdup(optarg);
 				break;
+			case 'j':
+				number_of_workers = atoi(optarg);
+				if(number_of_workers <= 0) {
+					number_of_workers = sysconf(_SC_NPROCESSORS_ONLN);
+				}
+				break;
+			case 'I':
+				options.isolate = 1;
+				break;
+			case 'M':
+				options.max_rss = strtoul(optarg, NULL, 10);
+				options.isolate = 1;
+				break;
+			case 'A':
+				options.max_address_space = strtoul(optarg, NULL, 10);
+				options.isolate = 1;
+				break;
+			case 'C':
+				options.max_cpu = strtoul(optarg, NULL, 10);
+				options.isolate = 1;
+				break;
+			case 'B':
+				options.bench = 1;
+				break;
+			case 'T':
+				options.bench_time = strtoul(optarg, NULL, 10);
+				break;
+			case 'S':
+				options.slowest = atoi(optarg);
+				break;
+			case 'W':
+				options.timeout_ms = strtoul(optarg, NULL, 10);
+				break;
+			case 'D':
+				options.deadline = strtoul(optarg, NULL, 10);
+				break;
+			case 'i':
+				options.shard_index = atoi(optarg);
+				break;
+			case 'n':
+				options.total_shards = atoi(optarg);
+				break;
+			case 'r':
+				options.timings_file = strdup(optarg);
+				break;
+			case 'w':
+				options.save_timings_file = strdup(optarg);
+				break;
+			case 'F':
+				options.output_on_failure = 1;
+				options.capture = 1;
+				break;
+			case 'O':
+				reporter_add(optarg);
+				break;
+			case 'H':
+				options.history_file = strdup(optarg);
+				break;
+			case 'N':
+				no_history = 1;
+				break;
+			case 'd':
+				if(strcmp(optarg, "fork") == 0) {
+					options.death_test_style = _CTESTER_DEATH_TEST_FORK;
+				}
+				else if(strcmp(optarg, "vfork") == 0) {
+					options.death_test_style = _CTESTER_DEATH_TEST_VFORK;
+				}
+				else {
+					print_info(31, _CTESTER_INFO_FAILED, "Invalid death test style %s, expected fork or vfork.\n", optarg);
+					exit(1);
+				}
+				break;
+			case 'P':
+				options.counters = 0;
+				for(char *list = strdup(optarg), *state = NULL, *name = strtok_r(list, ",", &state); name; name = strtok_r(NULL, ",", &state)) {
+					int counter = 0;
+					while(counter < _CTESTER_NUMBER_OF_COUNTERS && strcmp(name, counter_events[counter].name) != 0) {
+						counter++;
+					}
+					if(counter == _CTESTER_NUMBER_OF_COUNTERS) {
+						print_info(31, _CTESTER_INFO_FAILED, "Invalid counter %s, expected instructions, cycles, cache-misses, branch-misses, task-clock, page-faults or context-switches.\n", name);
+						exit(1);
+					}
+					options.counters |= 1U << counter;
+				}
+				break;
+			case 'R':
+				options.repeat = atoi(optarg);
+				if(options.repeat < 1) {
+					print_info(31, _CTESTER_INFO_FAILED, "Invalid number of repetitions %s.\n", optarg);
+					exit(1);
+				}
+				break;
+			case 'e':
+				options.seed = strtoull(optarg, NULL, 10);
+				options.seed_given = 1;
+				options.shuffle = 1;
+				break;
+			case 'p':
+				options.property_runs = strtoul(optarg, NULL, 10);
+				if(options.property_runs < 1) {
+					print_info(31, _CTESTER_INFO_FAILED, "Invalid number of property runs %s.\n", optarg);
+					exit(1);
+				}
+				break;
+			case 'm':
+				options.property_time_ms = strtoul(optarg, NULL, 10);
+				break;
+			case 's':
+				options.property_seed = strtoull(optarg, NULL, 10);
+				options.property_seed_given = 1;
+				break;
+			case 'a':
+				options.threads_time_ms = strtoul(optarg, NULL, 10);
+				break;
+			case 'o':
+				if(strcmp(optarg, "name") == 0) {
+					options.order = _CTESTER_ORDER_NAME;
+				}
+				else if(strcmp(optarg, "failed-first") == 0) {
+					options.order = _CTESTER_ORDER_FAILED_FIRST;
+				}
+				else if(strcmp(optarg, "slowest-first") == 0) {
+					options.order = _CTESTER_ORDER_SLOWEST_FIRST;
+				}
+				else {
+					print_info(31, _CTESTER_INFO_FAILED, "Invalid order %s, expected name, failed-first or slowest-first.\n", optarg);
+					exit(1);
+				}
+				break;
+			case 0:
+				// Long option that only sets a flag
+				break;
 			default:
 				print_help(argv[0]);
 				exit(1);
@@ -127,85 +4710,338 @@ int main(int argc, char *argv[]) {
 		}
 	}
 
-	setvbuf(stdout, NULL, _IONBF, 0);
+	if(options.total_shards < 1 || options.shard_index < 0 || options.shard_index >= options.total_shards) {
+		fprintf(stderr, "Invalid shard index %d for %d shards.\n", options.shard_index, options.total_shards);
+		exit(1);
+	}
+	if(getenv("GTEST_SHARD_STATUS_FILE")) {
+		// Announce that sharding is supported, like GTest does
+		FILE *status_file = fopen(getenv("GTEST_SHARD_STATUS_FILE"), "w");
+		if(status_file) {
+			fclose(status_file);
+		}
+	}
+
+	// Workers inherit the seed, such that a single one reproduces all properties
+	if(!options.property_seed_given) {
+		options.property_seed = get_clock_ns() ^ ((uint64_t)getpid() << 32);
+	}
+
+	add_module(argv[0], NULL, &binary_module);
+	for(int i = optind; i < argc; i++) {
+		load_module(argv[i]);
+	}
+	collect_tests();
+
+	if(list) {
+		print_list();
+		exit(0);
+	}
+
+	if(options.timings_file && load_timings(options.timings_file, 1) < 0) {
+		print_info(33, _CTESTER_INFO_WARNING, "Failed to read timings from %s: %s\n", options.timings_file, strerror(errno));
+	}
+
+	// Each binary keeps its own history by default
+	if(no_history) {
+		free((char *)options.history_file);
+		options.history_file = NULL;
+	}
+	else if(!options.history_file) {
+		size_t history_file_size = strlen(argv[0]) + sizeof(".history");
+		char *history_file = malloc(history_file_size);
+		snprintf(history_file, history_file_size, "%s.history", argv[0]);
+		options.history_file = history_file;
+	}
+	if(options.history_file) {
+		load_history(options.history_file);
+	}
+	else {
+		history = calloc(ctester_number_of_tests ? ctester_number_of_tests : 1, sizeof(struct ctester_history_t));
+	}
+	int rerun_failed = 0;
+	if(options.last_failed) {
+		for(int i = 0; i < ctester_number_of_tests; i++) {
+			rerun_failed |= history[i].failed;
+		}
+		if(!rerun_failed) {
+			print_info(33, _CTESTER_INFO_WARNING, "No test failed in the previous run, running all tests.\n");
+		}
+	}
+
+	// Output from workers and isolated tests would interleave otherwise, and
+	// reports include the output of each test
+	if(options.capture < 0) {
+		options.capture = (number_of_workers > 1 || options.isolate || number_of_reporters > 0) && !options.bench;
+	}
+	if(options.capture) {
+		capture.fd = capture_create();
+	}
+
+	// Find out which counters are available before workers open their own
+	counters_open(1);
 
 	// Select all test cases matching the pattern
-	struct ctester_test_case_list_t *test = ctester_test_root;
-	struct ctester_test_case_list_t *test_case_start = test;
+	struct ctester_test_case_list_t *test;
+	struct ctester_test_case_list_t *tests_end = ctester_tests + ctester_number_of_tests;
 	int total_test_count = 0, total_test_case_count = 0, total_disabled_tests = 0;
-	while(test) {
-		if(strcmp(test->test_case_name, test_case_start->test_case_name)) {
-			test_case_start = test;
-		}
-		if(fnmatch(pattern, test->full_test_name, 0) == 0) {
+	for(test = ctester_tests; test < tests_end; test++) {
+		if((test->benchmark_body != NULL) == options.bench && fnmatch(pattern, test->full_test_name, 0) == 0) {
 			if(strncmp(test->test_name, "DISABLED_", sizeof("DISABLED_") - 1) == 0 && strcmp(test->full_test_name, pattern) != 0) {
 				total_disabled_tests++;
 				print_info(33, _CTESTER_INFO_WARNING, "Test %s is disabled. Give its name using -t explicitly if you want to run it.\n", test->full_test_name);
-				test = test->next;
 				continue;
 			}
-			if(!test_case_start->number_of_tests) {
-				total_test_case_count++;
+			if(rerun_failed && !history[test - ctester_tests].failed) {
+				continue;
 			}
 			total_test_count++;
-			test_case_start->number_of_tests++;
 			test->state = _CTESTER_STATE_SCHEDULED;
 		}
+	}
+
+	// Put the scheduled tests into an array, such that workers can refer to them by index
+	struct ctester_test_case_list_t **schedule = calloc(total_test_count ? total_test_count : 1, sizeof(struct ctester_test_case_list_t *));
+	int schedule_length = 0;
+	for(test = ctester_tests; test < tests_end; test++) {
+		if(test->state == _CTESTER_STATE_SCHEDULED) {
+			schedule[schedule_length++] = test;
+		}
+	}
+
+	// Drop the tests of other shards
+	if(options.total_shards > 1) {
+		shard_tests(schedule, schedule_length);
+		schedule_length = 0;
+		for(test = ctester_tests; test < tests_end; test++) {
+			if(test->state == _CTESTER_STATE_SCHEDULED) {
+				schedule[schedule_length++] = test;
+			}
+		}
+		total_test_count = schedule_length;
+	}
+
+	if(options.order == _CTESTER_ORDER_FAILED_FIRST) {
+		qsort(schedule, schedule_length, sizeof(struct ctester_test_case_list_t *), compare_failed_first);
+	}
+	else if(options.order == _CTESTER_ORDER_SLOWEST_FIRST) {
+		qsort(schedule, schedule_length, sizeof(struct ctester_test_case_list_t *), compare_slowest_first);
+	}
 
-		test = test->next;
+	// Count the tests per test case
+	struct ctester_test_case_list_t *test_case_start = ctester_tests;
+	for(test = ctester_tests; test < tests_end; test++) {
+		if(strcmp(test->test_case_name, test_case_start->test_case_name)) {
+			test_case_start = test;
+		}
+		if(test->state == _CTESTER_STATE_SCHEDULED) {
+			if(!test_case_start->number_of_tests) {
+				total_test_case_count++;
+			}
+			test_case_start->number_of_tests++;
+		}
 	}
 
+	watchdog_start();
+
 	// Run all test cases and fetch some statistics
-	test = ctester_test_root;
-	test_case_start = NULL;
-	unsigned long overall_start_time = get_clock_ms();
-	unsigned long test_case_start_time = overall_start_time;
+	int test_case_length = 0;
+	unsigned long long overall_start_time = get_clock_ns();
+	unsigned long long test_case_run_time = 0, test_case_body_time = 0;
+	struct ctester_test_timing_t *timings = calloc(schedule_length ? schedule_length : 1, sizeof(struct ctester_test_timing_t));
 
+	// Passed and failed runs of tests, summed up over all iterations
 	unsigned passed_tests = 0, failed_tests = 0;
 
-	print_info(32, _CTESTER_INFO_THICK_BAR, "Running %d test%s from %d test case%s.\n", total_test_count, total_test_count == 1 ? "" : "s", total_test_case_count, total_test_case_count == 1 ? "" : "s");
-	while(test) {
-		if(!test_case_start || strcmp(test->test_case_name, test_case_start->test_case_name)) {
-			if(test_case_start && test_case_start->number_of_tests) {
-				print_info(32, _CTESTER_INFO_THIN_BAR, "%d test%s from %s (%lu ms total)\n", test_case_start->number_of_tests, test_case_start->number_of_tests == 1 ? "" : "s", test_case_start->test_case_name, get_clock_ms() - test_case_start_time);
+	int iterations = options.repeat ? options.repeat : !options.until_fail;
+	if(iterations != 1) {
+		repeat_stats = calloc(ctester_number_of_tests ? ctester_number_of_tests : 1, sizeof(struct ctester_repeat_stats_t));
+	}
+	struct ctester_test_case_list_t **unshuffled = NULL;
+	if(options.shuffle) {
+		if(!options.seed_given) {
+			options.seed = get_clock_ns() ^ ((uint64_t)getpid() << 32);
+		}
+		unshuffled = calloc(schedule_length ? schedule_length : 1, sizeof(struct ctester_test_case_list_t *));
+		memcpy(unshuffled, schedule, schedule_length * sizeof(struct ctester_test_case_list_t *));
+	}
+
+	reporters_begin();
+	for(int iteration = 0; iterations == 0 || iteration < iterations; iteration++) {
+		if(iterations != 1) {
+			if(iterations) {
+				print_info(32, _CTESTER_INFO_THICK_BAR, "Iteration %d of %d.\n", iteration + 1, iterations);
 			}
-			test_case_start = test;
-			if(test_case_start->number_of_tests) {
-				print_info(32, _CTESTER_INFO_THIN_BAR, "%d test%s from %s\n", test_case_start->number_of_tests, test_case_start->number_of_tests == 1 ? "" : "s", test_case_start->test_case_name);
-				test_case_start_time = get_clock_ms();
+			else {
+				print_info(32, _CTESTER_INFO_THICK_BAR, "Iteration %d.\n", iteration + 1);
 			}
 		}
+		if(unshuffled) {
+			// Each iteration has a seed of its own, which reproduces its order
+			print_info(32, _CTESTER_INFO_THICK_BAR, "Shuffling tests with --seed %" PRIu64 ".\n", options.seed + iteration);
+			shuffle_tests(unshuffled, schedule, schedule_length, options.seed + iteration);
+		}
 
-		if(test->state == _CTESTER_STATE_SCHEDULED) {
-			struct ctester_test_case_state_t state;
-			memset(&state, 0, sizeof(struct ctester_test_case_state_t));
-			test->state = _CTESTER_STATE_SCHEDULED;
+		// Benchmarks always run serially and in-process, such that they do not disturb each other
+		struct ctester_pool_t *pool = NULL;
+		if(number_of_workers > 1 && schedule_length > 1 && !options.bench) {
+			pool = pool_create(schedule, schedule_length, number_of_workers);
+			watchdog.pool = pool;
+		}
+
+		unsigned long long iteration_start_time = get_clock_ns();
+		unsigned iteration_failed_tests = 0;
+		test_case_start = NULL;
+		print_info(32, _CTESTER_INFO_THICK_BAR, "Running %d test%s from %d test case%s.\n", total_test_count, total_test_count == 1 ? "" : "s", total_test_case_count, total_test_case_count == 1 ? "" : "s");
+		for(int index = 0; index < schedule_length; index++) {
+			test = schedule[index];
+			if(!test_case_start || strcmp(test->test_case_name, test_case_start->test_case_name)) {
+				if(test_case_start) {
+					print_info(32, _CTESTER_INFO_THIN_BAR, "%d test%s from %s (", test_case_length, test_case_length == 1 ? "" : "s", test_case_start->test_case_name);
+					print_durations(test_case_run_time, test_case_body_time);
+					printf(")\n");
+					reporters_test_case_end();
+					leave_test_case();
+				}
+				// Unless tests run by name, a test case may be split into several runs
+				test_case_start = test;
+				test_case_length = 1;
+				while(index + test_case_length < schedule_length && !strcmp(schedule[index + test_case_length]->test_case_name, test->test_case_name)) {
+					test_case_length++;
+				}
+				print_info(32, _CTESTER_INFO_THIN_BAR, "%d test%s from %s\n", test_case_length, test_case_length == 1 ? "" : "s", test_case_start->test_case_name);
+				reporters_test_case_begin(test_case_start->test_case_name, test_case_length);
+				test_case_run_time = 0;
+				test_case_body_time = 0;
+			}
 
 			print_info(32, _CTESTER_INFO_RUN, "%s\n", test->full_test_name);
+			// Make sure uncaptured output of the test appears after this line
+			fflush(stdout);
 
-			unsigned long test_start_time = get_clock_ms();
-			// This is where the actual test case is executed
-			test->test_body(&state);
-			unsigned long test_run_time = get_clock_ms() - test_start_time;
+			struct ctester_test_result_t local_result;
+			memset(&local_result, 0, sizeof(struct ctester_test_result_t));
+			struct ctester_test_result_t *result = &local_result;
+			struct ctester_benchmark_stats_t stats;
+			if(options.bench) {
+				run_benchmark(test, result, &stats);
+			}
+			else if(pool) {
+				result = pool_wait(pool, index);
+			}
+			else {
+				execute_test(test, result);
+				capture_read(capture.fd, result);
+			}
+			test_case_run_time += result->duration;
+
+			if(result->output_size && (!options.output_on_failure || result->failed != 0)) {
+				fflush(stdout);
+				write_full(2, result->output, result->output_size);
+			}
+			test_case_body_time += result->body_duration;
+			timings[index].test = test;
+			timings[index].duration = result->duration;
+
+			char message[512];
+			if(result->failed < 0) {
+				if(result->timed_out) {
+					snprintf(message, sizeof(message), "%s timed out after %lu ms.", test->full_test_name, options.timeout_ms);
+				}
+				else if(exceeded_max_rss(result)) {
+					snprintf(message, sizeof(message), "Process running %s exceeded the memory limit of %lu MiB.", test->full_test_name, options.max_rss);
+				}
+				else if(WIFSIGNALED(result->status)) {
+					snprintf(message, sizeof(message), "Process crashed while running %s with signal %d (%s).", test->full_test_name, WTERMSIG(result->status), strsignal(WTERMSIG(result->status)));
+				}
+				else {
+					snprintf(message, sizeof(message), "Process exited with status %d while running %s.", WEXITSTATUS(result->status), test->full_test_name);
+				}
+				fprintf(stderr, _CTESTER_INDENT "%s\n", message);
+			}
+			reporters_test_end(test, result, options.bench && result->failed == 0 ? &stats : NULL, result->failed < 0 ? message : NULL);
+			free(result->output);
+			result->output = NULL;
 
-			if(state.failed == 0) {
-				test->state = _CTESTER_STATE_SUCCEEDED;
+			if(result->failed == 0) {
+				// A test that failed in an earlier iteration stays failed
+				if(test->state != _CTESTER_STATE_FAILED) {
+					test->state = _CTESTER_STATE_SUCCEEDED;
+				}
 				passed_tests++;
-				print_info(state.warning == 0 ? 32 : 33, _CTESTER_INFO_OK, "%s (%lu ms total)\n", test->full_test_name, test_run_time);
+				print_info(result->warning == 0 ? 32 : 33, _CTESTER_INFO_OK, "%s (", test->full_test_name);
 			}
 			else {
 				test->state = _CTESTER_STATE_FAILED;
 				failed_tests++;
-				print_info(31, _CTESTER_INFO_FAILED, "%s (%lu ms total)\n", test->full_test_name,test_run_time);
+				iteration_failed_tests++;
+				print_info(31, _CTESTER_INFO_FAILED, "%s (", test->full_test_name);
 			}
+			print_durations(result->duration, result->body_duration);
+			print_usage(result);
+			printf(")\n");
+			if(options.bench && result->failed == 0) {
+				print_info(32, _CTESTER_INFO_BENCH, "%s: %.1f ns/op mean, %.1f median, %.1f stddev, %.1f min, %.1f p99 (%d x %lu iterations)\n",
+					test->full_test_name, stats.mean, stats.median, stats.stddev, stats.min, stats.p99, _CTESTER_BENCHMARK_SAMPLES, stats.iterations);
+			}
+			if(options.history_file && !options.bench) {
+				update_history(test, test->state == _CTESTER_STATE_FAILED, result->duration);
+			}
+			if(repeat_stats) {
+				update_repeat_stats(test, result);
+			}
+		}
+		if(test_case_start) {
+			print_info(32, _CTESTER_INFO_THIN_BAR, "%d test%s from %s (", test_case_length, test_case_length == 1 ? "" : "s", test_case_start->test_case_name);
+			print_durations(test_case_run_time, test_case_body_time);
+			printf(")\n");
+			reporters_test_case_end();
+			leave_test_case();
 		}
+		print_info(32, _CTESTER_INFO_THICK_BAR, "%d test%s from %d test case%s ran. (", total_test_count, total_test_count == 1 ? "" : "s", total_test_case_count, total_test_case_count == 1 ? "" : "s");
+		unsigned long long iteration_run_time = get_clock_ns() - iteration_start_time;
+		print_durations(iteration_run_time, iteration_run_time);
+		printf(")\n");
+
+		if(pool) {
+			watchdog.pool = NULL;
+			pool_destroy(pool);
+		}
+		if(options.until_fail && iteration_failed_tests) {
+			break;
+		}
+	}
+	unsigned long long overall_run_time = get_clock_ns() - overall_start_time;
+	reporters_end(passed_tests, failed_tests, total_disabled_tests, overall_run_time);
 
-		test = test->next;
+	if(options.save_timings_file) {
+		for(int index = 0; index < schedule_length; index++) {
+			timings[index].test->expected_duration = timings[index].duration;
+		}
+		save_timings(options.save_timings_file);
+	}
+	if(options.history_file && !options.bench) {
+		save_history(options.history_file);
+	}
+	free(history);
+	if(options.slowest > 0 && schedule_length > 0) {
+		print_slowest(timings, schedule_length, options.slowest);
+	}
+	free(timings);
+	if(repeat_stats) {
+		print_repeat_stats();
+		free(repeat_stats);
 	}
-	if(test_case_start && test_case_start->number_of_tests) {
-		print_info(32, _CTESTER_INFO_THIN_BAR, "%d test%s from %s (%lu ms total)\n", test_case_start->number_of_tests, test_case_start->number_of_tests == 1 ? "" : "s", test_case_start->test_case_name, get_clock_ms() - test_case_start_time);
+	free(unshuffled);
+	free(schedule);
+
+	// With --repeat, count each test once, as failed if it failed in any iteration
+	passed_tests = 0;
+	failed_tests = 0;
+	for(test = ctester_tests; test < tests_end; test++) {
+		passed_tests += test->state == _CTESTER_STATE_SUCCEEDED;
+		failed_tests += test->state == _CTESTER_STATE_FAILED;
 	}
-	print_info(32, _CTESTER_INFO_THICK_BAR, "%d test%s from %d test case%s ran. (%lu ms total)\n", total_test_count, total_test_count == 1 ? "" : "s", total_test_case_count, total_test_case_count == 1 ? "" : "s", get_clock_ms() - overall_start_time);
 
 	// Output the overall status and list the failed test cases a second time
 	if(passed_tests) {
@@ -216,17 +5052,14 @@ int main(int argc, char *argv[]) {
 	}
 	if(failed_tests) {
 		print_info(31, _CTESTER_INFO_FAILED, "%d test%s, listed below:\n", failed_tests, failed_tests == 1 ? "" : "s");
-		test = ctester_test_root;
-		while(test) {
+		for(test = ctester_tests; test < tests_end; test++) {
 			if(test->state == _CTESTER_STATE_FAILED) {
 				print_info(31, _CTESTER_INFO_FAILED, "%s\n", test->full_test_name);
 			}
-			test = test->next;
 		}
 		printf("\n\n %d FAILED TEST%s\n", failed_tests, failed_tests == 1 ? "" : "s");
-
-		return 1;
 	}
 
-	return 0;
+	unload_modules();
+	return failed_tests ? 1 : 0;
 }
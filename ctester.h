@@ -7,6 +7,7 @@
 #include <errno.h>
 #include <float.h>
 #include <math.h>
+#include <setjmp.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -22,15 +23,121 @@
  * \internal
  */
 struct ctester_test_case_state_t {
-	int failed;  //<<< Stores the line number where a failure occurred
-	int warning; //<<< Stores the number of warnings issued from this test
+	int failed;          //<<< Stores the line number where a failure occurred
+	int warning;         //<<< Stores the number of warnings issued from this test
+	FILE *output;        //<<< Stream failures are reported on, or NULL for stderr
+	jmp_buf *fatal_jump; //<<< Where a fatal failure returns to, or NULL to return from the test, see ::EXPECT_FATAL_FAILURE
+};
+
+/// Maximum number of parameters a ::TEST_P receives from its generator
+#define _CTESTER_MAX_PARAMS 8
+
+#define _CTESTER_GENERATOR_RANGE 0
+#define _CTESTER_GENERATOR_VALUES 1
+#define _CTESTER_GENERATOR_COMBINE 2
+
+/**
+ * A parameter of a ::TEST_P, see ::PARAM_INT and ::PARAM_VALUE.
+ */
+union ctester_param_t {
+	long long integer;  //<<< Value from a ::CTESTER_RANGE
+	const void *value;  //<<< Pointer to a value from ::CTESTER_VALUES
+};
+
+/**
+ * Generator of parameters for a ::TEST_P.
+ *
+ * A generator does not store the parameters it generates, but computes the
+ * one at a given index when the test runs.
+ *
+ * \internal
+ */
+struct ctester_generator_t {
+	int kind;                                         //<<< One of the `_CTESTER_GENERATOR_*` constants
+	long long start;                                  //<<< First value of a range
+	long long end;                                    //<<< End of a range, exclusive
+	long long step;                                   //<<< Step of a range
+	const void *values;                               //<<< Array of values
+	size_t value_size;                                //<<< Size of an element of ::values
+	const struct ctester_generator_t *const *factors; //<<< Generators combined
+	size_t count;                                     //<<< Number of ::values or ::factors
+};
+
+/**
+ * Instantiation of the ::TEST_P tests of a test case, see
+ * ::INSTANTIATE_TEST_CASE_P.
+ *
+ * \internal
+ */
+struct ctester_instantiation_t {
+	const char *prefix;                         //<<< Name of the instantiation
+	const char *test_case_name;                 //<<< Test case whose ::TEST_P tests are instantiated
+	const struct ctester_generator_t *generator; //<<< Generator of the parameters
+};
+
+#define _CTESTER_ARBITRARY_INT 0
+#define _CTESTER_ARBITRARY_DOUBLE 1
+#define _CTESTER_ARBITRARY_BYTES 2
+#define _CTESTER_ARBITRARY_STRING 3
+#define _CTESTER_ARBITRARY_ARRAY 4
+
+/**
+ * Generator of random inputs for a ::PROPERTY, see ::CTESTER_ANY_INT and
+ * friends.
+ *
+ * \internal
+ */
+struct ctester_arbitrary_t {
+	int kind;                                  //<<< One of the `_CTESTER_ARBITRARY_*` constants
+	long long min;                             //<<< Smallest integer
+	long long max;                             //<<< Largest integer
+	double min_double;                         //<<< Smallest double
+	double max_double;                         //<<< Largest double
+	size_t min_size;                           //<<< Smallest number of bytes, characters or elements
+	size_t max_size;                           //<<< Largest number of bytes, characters or elements
+	const struct ctester_arbitrary_t *element; //<<< Generator of the elements of an array
+};
+
+/**
+ * An input of a ::PROPERTY, see ::PROPERTY_INT and friends.
+ */
+struct ctester_property_value_t {
+	long long integer; //<<< Value from a ::CTESTER_ANY_INT
+	double real;       //<<< Value from a ::CTESTER_ANY_DOUBLE
+	const void *data;  //<<< Contents from a ::CTESTER_ANY_BYTES, ::CTESTER_ANY_STRING or ::CTESTER_ANY_ARRAY
+	size_t size;       //<<< Number of bytes, characters or elements in ::data
+};
+
+/**
+ * A ::PROPERTY and the generators of its inputs.
+ *
+ * \internal
+ */
+struct ctester_property_t {
+	void (*body)(struct ctester_test_case_state_t *ctester_state, const struct ctester_property_value_t *ctester_property); //<<< Body of the property
+	const struct ctester_arbitrary_t *const *arbitraries; //<<< Generator of each input
+	size_t count;                                         //<<< Number of ::arbitraries
+	const char *file;                                     //<<< File the property is defined in
+	int line;                                             //<<< Line the property is defined at
+};
+
+/**
+ * A ::TEST_THREADS and the number of threads it runs on.
+ *
+ * \internal
+ */
+struct ctester_threads_t {
+	void (*loop)(struct ctester_test_case_state_t *ctester_state, int ctester_thread, int ctester_number_of_threads, const int *stop, unsigned long long *operations); //<<< Run the body until `stop` is set or it fails, and count its runs
+	int number_of_threads;      //<<< Largest number of threads to run on, or 0 for one per online CPU
+	const char *full_test_name; //<<< Name of the test, for the scaling report
 };
 
 /**
  * Structure storing information on test cases.
  *
- * This structure is populated from constructors automatically generated for
- * each test.
+ * An instance of this structure is emitted for each test, and a pointer to it
+ * is placed in the `ctester_tests` linker section. At startup, the runner
+ * copies them into the ::ctester_tests array.
  *
  * \internal
  */
@@ -39,59 +146,148 @@ struct ctester_test_case_list_t {
 	char *test_case_name; //<<< Test case name
 	char *test_name;      //<<< Test name
 	void (*test_body)(struct ctester_test_case_state_t *ctester_state); //<<< Pointer to the test's wrapping function
+	void (*benchmark_body)(struct ctester_test_case_state_t *ctester_state, unsigned long iterations); //<<< Pointer to the benchmark's loop, NULL for tests
 	int state;            //<<< State, used internally in ::main.
 	int number_of_tests;  //<<< Used to store the number of tests in this case, only used in the first test of a case
-	struct ctester_test_case_list_t *next; //<<< Pointer to the next test, or NULL
+	unsigned long long expected_duration; //<<< Run time in nanoseconds according to a timings file, or 0 if unknown
+	void (*set_up_test_case)(struct ctester_test_case_state_t *ctester_state);    //<<< Hook run before the first test of the case, or NULL
+	void (*tear_down_test_case)(struct ctester_test_case_state_t *ctester_state); //<<< Hook run after the last test of the case, or NULL
+	void (*param_body)(struct ctester_test_case_state_t *ctester_state, const union ctester_param_t *ctester_params); //<<< Pointer to the body of a ::TEST_P, NULL for other tests
+	const struct ctester_generator_t *generator; //<<< Generator of the parameters of a ::TEST_P
+	size_t param_index;   //<<< Index of the parameters of this instance of a ::TEST_P in ::generator
+};
+/**
+ * Heap allocations of the current test, counted if `ctester-alloc.c` is
+ * linked into the test binary. The runner resets them before each test.
+ *
+ * Blocks are accounted with their usable size. As blocks allocated before the
+ * test may be released during it, ::live_bytes is a net value.
+ */
+struct ctester_alloc_stats_t {
+	unsigned long long allocations; //<<< Number of blocks allocated, including reallocations
+	unsigned long long frees;       //<<< Number of blocks released
+	unsigned long long bytes;       //<<< Bytes allocated in total
+	long long live_bytes;           //<<< Bytes allocated but not released
+	long long peak_live_bytes;      //<<< Maximum of ::live_bytes
+};
+extern struct ctester_alloc_stats_t ctester_alloc_stats; //<<< Defined in `ctester-alloc.c`
+extern _Thread_local int _ctester_alloc_untracked;       //<<< Set while the runner allocates on behalf of a test in this thread, which is not counted \internal
+
+extern struct ctester_test_case_list_t *ctester_tests; //<<< Global array holding all tests, sorted by name
+extern int ctester_number_of_tests;                    //<<< Number of tests in ::ctester_tests
+
+/**
+ * Registrations of a shared object of tests, exported as `ctester_module` by
+ * `ctester-module.c`. The runner looks it up in each shared object it loads,
+ * as the linker's section bounds are not visible outside of the object.
+ *
+ * \internal
+ */
+struct ctester_module_t {
+	struct ctester_test_case_list_t **tests_start;                 //<<< Start of the `ctester_tests` section
+	struct ctester_test_case_list_t **tests_stop;                  //<<< End of the `ctester_tests` section
+	const struct ctester_instantiation_t **instantiations_start;   //<<< Start of the `ctester_instantiations` section
+	const struct ctester_instantiation_t **instantiations_stop;    //<<< End of the `ctester_instantiations` section
 };
-extern struct ctester_test_case_list_t *ctester_test_root; //<<< Global variable holding the head of the test list
 
 #define _CTESTER_INDENT "     "
 
+#define _CTESTER_VALUE_SIGNED 0
+#define _CTESTER_VALUE_UNSIGNED 1
+#define _CTESTER_VALUE_FLOAT 2
+#define _CTESTER_VALUE_DOUBLE 3
+#define _CTESTER_VALUE_LONG_DOUBLE 4
+#define _CTESTER_VALUE_STRING 5
+#define _CTESTER_VALUE_POINTER 6
+
 /**
- * Format specifier for all formats supported by the assertion macros.
+ * A value compared by an assertion, tagged with its type, such that it can
+ * be printed by the out-of-line failure reporting functions.
  *
- * By default, variables will be interpreted as pointers (i.e. printed in hex, assuming size_t size).
+ * \internal
  */
-#define _CTESTER_FMT(x) _Generic((x), \
-	unsigned char: "%u", \
-	unsigned short: "%u", \
-	unsigned int: "%u", \
-	unsigned long int: "%lu", \
-	unsigned long long int: "%llu", \
-	char: "%d", \
-	short: "%d", \
-	int: "%d", \
-	long int: "%ld", \
-	long long int: "%lld", \
-	double: "%g", \
-	long double: "%lg", \
-	float: "%f", \
-	char *: "%s", \
-	unsigned char *: "%s", \
-	default: "%p")
+struct ctester_value_t {
+	int kind; //<<< One of the `_CTESTER_VALUE_*` constants
+	union {
+		long long integer;                   //<<< Value of a signed integer
+		unsigned long long unsigned_integer; //<<< Value of an unsigned integer
+		const void *pointer;                 //<<< Value of a string or pointer
+	};
+	// Outside of the union, whose ABI for passing by value changed with a long double in it
+	long double real; //<<< Value of a floating point number
+};
 
 /**
  * \defgroup err_printing Error printing
  * @{
  * \internal
+ *
+ * Failures are reported by functions that are kept out of line and marked as
+ * cold, such that an assertion that holds costs a comparison and a branch.
  */
-#define _CTESTER_ERR_PRINT2(CMP_S, a, a_value, b, b_value, custom_message, ...) \
-	fprintf(stderr, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s but\n" _CTESTER_INDENT "    %s == ", __FILE__, __LINE__, CMP_S, a); \
-	fprintf(stderr, _CTESTER_FMT(a_value), a_value); \
-	fprintf(stderr, ",\n" _CTESTER_INDENT "    %s == ", b); \
-	fprintf(stderr, _CTESTER_FMT(b_value), b_value); \
-	if(*custom_message) { \
-		fprintf(stderr, ",\n" _CTESTER_INDENT "    Message: " custom_message, ## __VA_ARGS__); \
-	} \
-	fprintf(stderr, "\n")
 
-#define _CTESTER_ERR_PRINT1(CMP_S, a, a_value, custom_message, ...) \
-	fprintf(stderr, _CTESTER_INDENT "%s (%s:%d): Failure.\n" _CTESTER_INDENT "    Expected: %s but\n" _CTESTER_INDENT "    %s == ", __func__, __FILE__, __LINE__, CMP_S, a); \
-	fprintf(stderr, _CTESTER_FMT(a_value), a_value); \
-	if(*custom_message) { \
-		fprintf(stderr, ",\n" _CTESTER_INDENT "    Message: " custom_message, ## __VA_ARGS__); \
-	} \
-	fprintf(stderr, "\n")
+/// Stream the assertions of the current test report failures on
+#define _CTESTER_OUTPUT (ctester_state->output ? ctester_state->output : stderr)
+
+struct ctester_value_t _ctester_value_signed(long long value);
+struct ctester_value_t _ctester_value_unsigned(unsigned long long value);
+struct ctester_value_t _ctester_value_float(float value);
+struct ctester_value_t _ctester_value_double(double value);
+struct ctester_value_t _ctester_value_long_double(long double value);
+struct ctester_value_t _ctester_value_string(const void *value);
+struct ctester_value_t _ctester_value_pointer(const void *value);
+
+/**
+ * Tag a value with its type for printing. Values of other types than those
+ * listed are printed as pointers.
+ */
+#define _CTESTER_VALUE(x) _Generic((x), \
+	_Bool: _ctester_value_unsigned, \
+	unsigned char: _ctester_value_unsigned, \
+	unsigned short: _ctester_value_unsigned, \
+	unsigned int: _ctester_value_unsigned, \
+	unsigned long int: _ctester_value_unsigned, \
+	unsigned long long int: _ctester_value_unsigned, \
+	char: _ctester_value_signed, \
+	signed char: _ctester_value_signed, \
+	short: _ctester_value_signed, \
+	int: _ctester_value_signed, \
+	long int: _ctester_value_signed, \
+	long long int: _ctester_value_signed, \
+	double: _ctester_value_double, \
+	long double: _ctester_value_long_double, \
+	float: _ctester_value_float, \
+	char *: _ctester_value_string, \
+	const char *: _ctester_value_string, \
+	unsigned char *: _ctester_value_string, \
+	const unsigned char *: _ctester_value_string, \
+	default: _ctester_value_pointer)(x)
+
+/**
+ * Report a failed comparison of `a` and `b`, and record it as a fatal or a
+ * nonfatal failure. The message is only printed if `has_message` is set.
+ */
+void _ctester_report_comparison(struct ctester_test_case_state_t *ctester_state, int fatal, const char *file, int line, const char *expression,
+	const char *a, struct ctester_value_t a_value, const char *b, struct ctester_value_t b_value, int has_message, const char *message_format, ...)
+	__attribute__((cold, noinline, format(printf, 11, 12)));
+
+/**
+ * Report a failed predicate on `a` in `function`, like
+ * ::_ctester_report_comparison.
+ */
+void _ctester_report_predicate(struct ctester_test_case_state_t *ctester_state, int fatal, const char *function, const char *file, int line, const char *expression,
+	const char *a, struct ctester_value_t a_value, int has_message, const char *message_format, ...)
+	__attribute__((cold, noinline, format(printf, 10, 11)));
+
+/// Report a failed comparison from within an assertion macro
+#define _CTESTER_REPORT2(fatal, CMP_S, a, a_value, b, b_value, custom_message, ...) \
+	_ctester_report_comparison(ctester_state, fatal, __FILE__, __LINE__, CMP_S, a, _CTESTER_VALUE(a_value), b, _CTESTER_VALUE(b_value), \
+		sizeof(custom_message) > 1, ",\n" _CTESTER_INDENT "    Message: " custom_message, ## __VA_ARGS__)
+
+/// Report a failed predicate from within an assertion macro
+#define _CTESTER_REPORT1(fatal, CMP_S, a, a_value, custom_message, ...) \
+	_ctester_report_predicate(ctester_state, fatal, __func__, __FILE__, __LINE__, CMP_S, a, _CTESTER_VALUE(a_value), \
+		sizeof(custom_message) > 1, ",\n" _CTESTER_INDENT "    Message: " custom_message, ## __VA_ARGS__)
 /// @}
 
 /**
@@ -102,14 +298,23 @@ extern struct ctester_test_case_list_t *ctester_test_root; //<<< Global variable
 
 inline void _ctester_nop() {}
 
+/**
+ * Record a fatal failure in line `line` of the current test. Within
+ * ::EXPECT_FATAL_FAILURE, this jumps back to the meta-assertion, otherwise
+ * the caller returns from the test.
+ */
+void _ctester_fatal_failure(struct ctester_test_case_state_t *ctester_state, int line);
+
+/// Record a nonfatal failure of the current test, which may run on several threads
+#define _CTESTER_NONFATAL_FAILURE() __atomic_add_fetch(&ctester_state->warning, 1, __ATOMIC_RELAXED)
+
 /// Expect `a CMP b` to hold and issue a warning if it doesn't.
 #define _CTESTER_EXPECT2(CMP, a, b, custom_message, ...) \
 	{ \
 		__typeof__(a) a_value = a; \
 		__typeof__(b) b_value = b; \
-		if(!(a_value CMP b_value)) { \
-			_CTESTER_ERR_PRINT2(#a " " #CMP " " #b, #a, a_value, #b, b_value, custom_message, ## __VA_ARGS__); \
-			ctester_state->warning++; \
+		if(__builtin_expect(!(a_value CMP b_value), 0)) { \
+			_CTESTER_REPORT2(0, #a " " #CMP " " #b, #a, a_value, #b, b_value, custom_message, ## __VA_ARGS__); \
 		} \
 	} \
 	_ctester_nop()
@@ -121,9 +326,8 @@ inline void _ctester_nop() {}
 	{ \
 		__typeof__(a) a_value = a; \
 		__typeof__(b) b_value = b; \
-		if(!(a_value CMP b_value)) { \
-			_CTESTER_ERR_PRINT2(#a " " #CMP " " #b, #a, a_value, #b, b_value, custom_message, ## __VA_ARGS__); \
-			ctester_state->failed = __LINE__; \
+		if(__builtin_expect(!(a_value CMP b_value), 0)) { \
+			_CTESTER_REPORT2(1, #a " " #CMP " " #b, #a, a_value, #b, b_value, custom_message, ## __VA_ARGS__); \
 			return; \
 		} \
 	} \
@@ -136,9 +340,8 @@ inline void _ctester_nop() {}
 	{ \
 		__typeof__(a) a_value = a; \
 		__typeof__(b) b_value = b; \
-		if(!(PRED(a_value, b_value))) { \
-			_CTESTER_ERR_PRINT2(#PRED "(" #a ", " #b ")", #a, a_value, #b, b_value, custom_message, ## __VA_ARGS__); \
-			ctester_state->warning++; \
+		if(__builtin_expect(!(PRED(a_value, b_value)), 0)) { \
+			_CTESTER_REPORT2(0, #PRED "(" #a ", " #b ")", #a, a_value, #b, b_value, custom_message, ## __VA_ARGS__); \
 		} \
 	} \
 	_ctester_nop()
@@ -150,9 +353,8 @@ inline void _ctester_nop() {}
 	{ \
 		__typeof__(a) a_value = a; \
 		__typeof__(b) b_value = b; \
-		if(!(PRED(a_value, b_value))) { \
-			_CTESTER_ERR_PRINT2(#PRED "(" #a ", " #b ")", #a, a_value, #b, b_value, custom_message, ## __VA_ARGS__); \
-			ctester_state->failed = __LINE__; \
+		if(__builtin_expect(!(PRED(a_value, b_value)), 0)) { \
+			_CTESTER_REPORT2(1, #PRED "(" #a ", " #b ")", #a, a_value, #b, b_value, custom_message, ## __VA_ARGS__); \
 			return; \
 		} \
 	} \
@@ -164,9 +366,8 @@ inline void _ctester_nop() {}
 #define _CTESTER_EXPECT1P(PRED, a, custom_message, ...) \
 	{ \
 		__typeof__(a) a_value = a; \
-		if(!(PRED(a_value))) { \
-			_CTESTER_ERR_PRINT1(#PRED "(" #a ")", #a, a_value, custom_message, ## __VA_ARGS__); \
-			ctester_state->warning++; \
+		if(__builtin_expect(!(PRED(a_value)), 0)) { \
+			_CTESTER_REPORT1(0, #PRED "(" #a ")", #a, a_value, custom_message, ## __VA_ARGS__); \
 		} \
 	} \
 	_ctester_nop()
@@ -177,9 +378,8 @@ inline void _ctester_nop() {}
 #define _CTESTER_ASSERT1P(PRED, a, custom_message, ...) \
 	{ \
 		__typeof__(a) a_value = a; \
-		if(!(PRED(a_value))) { \
-			_CTESTER_ERR_PRINT1(#PRED, #a, a_value, custom_message, ## __VA_ARGS__); \
-			ctester_state->failed = __LINE__; \
+		if(__builtin_expect(!(PRED(a_value)), 0)) { \
+			_CTESTER_REPORT1(1, #PRED, #a, a_value, custom_message, ## __VA_ARGS__); \
 			return; \
 		} \
 	} \
@@ -284,74 +484,193 @@ inline int _ctester_double_eq(double a, double b) { return fabs(a - b) < 10 * DB
 /// Expect that `pred(val1, val2)` holds
 #define EXPECT_PRED2(pred, val1, val2, ...) _CTESTER_EXPECT2P(pred, val1, val2, "" __VA_ARGS__)
 
-/// \internal
-#define _CTESTER_TEST_RUN_AS_CHILD(statement, status, exit_code_on_failure) \
-	sighandler_t old_handler = signal(SIGCHLD, SIG_DFL); \
-	pid_t child_pid = fork(); \
+/**
+ * A child process running the statement of a death test, see
+ * ::_CTESTER_TEST_RUN_AS_CHILD.
+ *
+ * \internal
+ */
+struct ctester_child_t {
+	int use_vfork;       //<<< Whether the child shares the memory of the test, see `--death-test-style`
+	int output_fd;       //<<< Read end of the pipe receiving the child's stderr, or -1
+	int child_fd;        //<<< Write end of that pipe, or -1
+	char *output;        //<<< Everything the child wrote to stderr, or NULL
+	size_t output_size;  //<<< Size of ::output
+	int restore_sigchld; //<<< Whether SIGCHLD was ignored before the child was created
+};
+
+/**
+ * Prepare the creation of a death test child. `allow_vfork` permits the
+ * child to share the memory of the test, if the runner was told to do so.
+ *
+ * \internal
+ */
+void _ctester_child_prepare(struct ctester_child_t *child, int allow_vfork);
+
+/**
+ * Set up a death test child from within the child, redirecting its stderr
+ * into the pipe.
+ *
+ * \internal
+ */
+void _ctester_child_started(struct ctester_child_t *child);
+
+/**
+ * Terminate a death test child whose statement returned.
+ *
+ * \internal
+ */
+void _ctester_child_exit(struct ctester_child_t *child, int exit_code) __attribute__((noreturn));
+
+/**
+ * Wait for a child forked by ::_CTESTER_TEST_RUN_AS_CHILD, collecting its
+ * stderr and killing it if it exceeds the runner's `--timeout-ms`. Returns -1
+ * on a timeout, 0 otherwise.
+ *
+ * \internal
+ */
+int _ctester_wait_child(struct ctester_child_t *child, pid_t child_pid, int *status, const char *file, int line);
+
+/**
+ * Check whether the stderr of a death test child matches the POSIX extended
+ * regular expression `regex`. An empty expression matches anything. The
+ * output is released if it matches.
+ *
+ * \internal
+ */
+int _ctester_child_output_matches(struct ctester_child_t *child, const char *regex, const char *file, int line);
+
+/**
+ * Print the stderr of a death test child to `output` and release it.
+ *
+ * \internal
+ */
+void _ctester_child_print_output(struct ctester_child_t *child, FILE *output);
+
+/**
+ * Run `statement` in a child process and wait for it.
+ *
+ * By default, the child is forked. With `--death-test-style vfork`, death
+ * tests use vfork(2) instead, which avoids copying the page tables of a big
+ * test process, but lets the statement modify the test's memory. The child
+ * then only makes async-signal-safe calls of its own before the statement,
+ * and stderr is unbuffered by the parent, as the stdio streams are shared.
+ *
+ * \internal
+ */
+#define _CTESTER_TEST_RUN_AS_CHILD(statement, status, exit_code_on_failure, allow_vfork) \
+	struct ctester_child_t child; \
+	_ctester_child_prepare(&child, allow_vfork); \
+	pid_t child_pid = child.use_vfork ? vfork() : fork(); \
 	if(child_pid == 0) { \
+		_ctester_child_started(&child); \
 		statement; \
-		exit(exit_code_on_failure); \
-	} \
-	while(1) { \
-		pid_t ret = waitpid(child_pid, &status, 0); \
-		if(ret < 0) { \
-			fprintf(stderr, _CTESTER_INDENT "%s:%d: Warning.\n" _CTESTER_INDENT "    waitpid(2) returned an error: %s (%d)\n", __FILE__, __LINE__, strerror(errno), errno); \
-		} \
-		if(ret == child_pid) { \
-			break; \
-		} \
+		_ctester_child_exit(&child, exit_code_on_failure); \
 	} \
-	signal(SIGCHLD, old_handler)
+	int timed_out = _ctester_wait_child(&child, child_pid, &status, __FILE__, __LINE__) < 0
 
 /// \internal
-#define _CTESTER_TEST_DEATH(statement, on_failure, custom_message, ...) \
+#define _CTESTER_TEST_DEATH(statement, on_failure, regex, custom_message, ...) \
 	{ \
 		int status = 0; \
-		_CTESTER_TEST_RUN_AS_CHILD(statement, status, 0); \
-		if(!WIFSIGNALED(status)) { \
-			fprintf(stderr, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s to crash, but the process exited with status %d.\n", __FILE__, __LINE__, #statement, WEXITSTATUS(status)); \
+		_CTESTER_TEST_RUN_AS_CHILD(statement, status, 0, 1); \
+		if(timed_out) { \
+			fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s to crash, but the process timed out.\n", __FILE__, __LINE__, #statement); \
+			if(*custom_message) { \
+				fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "    Message: " custom_message "\n", ## __VA_ARGS__); \
+			} \
+			_ctester_child_print_output(&child, _CTESTER_OUTPUT); \
+			on_failure; \
+		} \
+		else if(!WIFSIGNALED(status)) { \
+			fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s to crash, but the process exited with status %d.\n", __FILE__, __LINE__, #statement, WEXITSTATUS(status)); \
+			if(*custom_message) { \
+				fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "    Message: " custom_message "\n", ## __VA_ARGS__); \
+			} \
+			_ctester_child_print_output(&child, _CTESTER_OUTPUT); \
+			on_failure; \
+		} \
+		else if(!_ctester_child_output_matches(&child, regex, __FILE__, __LINE__)) { \
+			fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s to crash with output matching \"%s\", but it crashed with signal %d.\n", __FILE__, __LINE__, #statement, regex, WTERMSIG(status)); \
 			if(*custom_message) { \
-				fprintf(stderr, _CTESTER_INDENT "    Message: " custom_message "\n", ## __VA_ARGS__); \
+				fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "    Message: " custom_message "\n", ## __VA_ARGS__); \
 			} \
+			_ctester_child_print_output(&child, _CTESTER_OUTPUT); \
 			on_failure; \
 		} \
 		else { \
-			fprintf(stderr, _CTESTER_INDENT "%s:%d: Child crashed while running %s with signal %d.\n", __FILE__, __LINE__, #statement, WTERMSIG(status)); \
+			fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "%s:%d: Child crashed while running %s with signal %d.\n", __FILE__, __LINE__, #statement, WTERMSIG(status)); \
 		} \
 	} \
 	_ctester_nop()
 
-/// Assert that the statement crashes the program (such that it exits with a signal)
-#define ASSERT_DEATH(statement, ...) _CTESTER_TEST_DEATH(statement, ctester_state->failed = __LINE__; return, "" __VA_ARGS__)
-/// Expect that the statement crashes the program (such that it exits with a signal)
-#define EXPECT_DEATH(statement, ...) _CTESTER_TEST_DEATH(statement, ctester_state->warning++, "" __VA_ARGS__)
+/// \internal
+#define _CTESTER_TEST_DEATH_REGEX(statement, on_failure, regex, ...) _CTESTER_TEST_DEATH(statement, on_failure, "" regex, "" __VA_ARGS__)
+
+/**
+ * Assert that the statement crashes the program (such that it exits with a signal)
+ *
+ * An optional POSIX extended regular expression must match the output of the
+ * statement on stderr, e.g. `ASSERT_DEATH(abort_with_message(), "invalid
+ * state")`. A custom message may follow the expression.
+ */
+#define ASSERT_DEATH(statement, ...) _CTESTER_TEST_DEATH_REGEX(statement, _ctester_fatal_failure(ctester_state, __LINE__); return, __VA_ARGS__)
+/// Expect that the statement crashes the program (such that it exits with a signal), see ::ASSERT_DEATH
+#define EXPECT_DEATH(statement, ...) _CTESTER_TEST_DEATH_REGEX(statement, _CTESTER_NONFATAL_FAILURE(), __VA_ARGS__)
 
 // \internal
-#define _CTESTER_TEST_EXIT(statement, on_failure, exit_code, custom_message, ...) \
+#define _CTESTER_TEST_EXIT(statement, on_failure, exit_code, regex, custom_message, ...) \
 	{ \
 		int status; \
-		_CTESTER_TEST_RUN_AS_CHILD(statement, status, !exit_code); \
-		if(WIFSIGNALED(status)) { \
-			fprintf(stderr, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s to exit with code %d, but the process crashed with signal %d.\n", __FILE__, __LINE__, #statement, exit_code, WTERMSIG(status)); \
+		_CTESTER_TEST_RUN_AS_CHILD(statement, status, !exit_code, 0); \
+		if(timed_out) { \
+			fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s to exit with code %d, but the process timed out.\n", __FILE__, __LINE__, #statement, exit_code); \
+			if(*custom_message) { \
+				fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "    Message: " custom_message "\n", ## __VA_ARGS__); \
+			} \
+			_ctester_child_print_output(&child, _CTESTER_OUTPUT); \
+			on_failure; \
+		} \
+		else if(WIFSIGNALED(status)) { \
+			fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s to exit with code %d, but the process crashed with signal %d.\n", __FILE__, __LINE__, #statement, exit_code, WTERMSIG(status)); \
 			if(*custom_message) { \
-				fprintf(stderr, _CTESTER_INDENT "    Message: " custom_message "\n", ## __VA_ARGS__); \
+				fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "    Message: " custom_message "\n", ## __VA_ARGS__); \
 			} \
+			_ctester_child_print_output(&child, _CTESTER_OUTPUT); \
 			on_failure; \
 		} \
 		else if(WEXITSTATUS(status) != exit_code) { \
-			fprintf(stderr, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s to exit with code %d, but the process exited with status %d.\n", __FILE__, __LINE__, #statement, exit_code, WEXITSTATUS(status)); \
+			fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s to exit with code %d, but the process exited with status %d.\n", __FILE__, __LINE__, #statement, exit_code, WEXITSTATUS(status)); \
+			if(*custom_message) { \
+				fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "    Message: " custom_message "\n", ## __VA_ARGS__); \
+			} \
+			_ctester_child_print_output(&child, _CTESTER_OUTPUT); \
+			on_failure; \
+		} \
+		else if(!_ctester_child_output_matches(&child, regex, __FILE__, __LINE__)) { \
+			fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "%s:%d: Failure.\n" _CTESTER_INDENT "    Expected: %s to exit with output matching \"%s\".\n", __FILE__, __LINE__, #statement, regex); \
 			if(*custom_message) { \
-				fprintf(stderr, _CTESTER_INDENT "    Message: " custom_message "\n", ## __VA_ARGS__); \
+				fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "    Message: " custom_message "\n", ## __VA_ARGS__); \
 			} \
-				on_failure; \
+			_ctester_child_print_output(&child, _CTESTER_OUTPUT); \
+			on_failure; \
 		} \
 	} \
 	_ctester_nop()
 
-/// Assert that the statement exits the program normally
-#define ASSERT_EXIT(statement, exit_code, ...) _CTESTER_TEST_EXIT(statement, ctester_state->failed = __LINE__; return, exit_code, "") __VA_ARGS__;
-/// Expect that the statement exits the program normally
-#define EXPECT_EXIT(statement, exit_code, ...) _CTESTER_TEST_EXIT(statement, ctester_state->warning++, exit_code, "") __VA_ARGS__;
+/// \internal
+#define _CTESTER_TEST_EXIT_REGEX(statement, on_failure, exit_code, regex, ...) _CTESTER_TEST_EXIT(statement, on_failure, exit_code, "" regex, "" __VA_ARGS__)
+
+/**
+ * Assert that the statement exits the program normally
+ *
+ * Like ::ASSERT_DEATH, an optional regular expression must match the output
+ * of the statement on stderr, and may be followed by a custom message. Exit
+ * tests always fork, as the statement runs exit handlers.
+ */
+#define ASSERT_EXIT(statement, exit_code, ...) _CTESTER_TEST_EXIT_REGEX(statement, _ctester_fatal_failure(ctester_state, __LINE__); return, exit_code, __VA_ARGS__)
+/// Expect that the statement exits the program normally, see ::ASSERT_EXIT
+#define EXPECT_EXIT(statement, exit_code, ...) _CTESTER_TEST_EXIT_REGEX(statement, _CTESTER_NONFATAL_FAILURE(), exit_code, __VA_ARGS__)
 
 /// @}
 
@@ -360,16 +679,26 @@ inline int _ctester_double_eq(double a, double b) { return fabs(a - b) < 10 * DB
  * @{
  */
 
+/**
+ * Place a pointer to a test's ::ctester_test_case_list_t in the
+ * `ctester_tests` section, where the runner finds it through the linker's
+ * `__start_ctester_tests` and `__stop_ctester_tests` symbols. Used by ::TEST
+ * and ::BENCHMARK.
+ *
+ * \internal
+ */
+#define _CTESTER_REGISTER(TEST_INFO) \
+	static struct ctester_test_case_list_t *_ctester_registration_ ## TEST_INFO __attribute__((used, section("ctester_tests"))) = & TEST_INFO
+
 /**
  * Define a test within a test case
  *
  * This is the main macro you'll want to use to define your test cases.
  *
- * The macro uses insertion sort to create a sorted, linked list of tests in
- * the global ctester_test_root variable from a constructor function, using
- * GNU's "constructor" attribute. It emits a function definition for a function
- * named test_case__test_name, returning void and taking a
- * ::ctester_test_case_state_t pointer as an argument.
+ * The macro registers the test in a dedicated linker section, from which the
+ * runner builds the sorted ::ctester_tests array once at startup. It emits a
+ * function definition for a function named test_case__test_name, returning
+ * void and taking a ::ctester_test_case_state_t pointer as an argument.
  *
  * Example:
  * \code{.c}
@@ -387,54 +716,917 @@ inline int _ctester_double_eq(double a, double b) { return fabs(a - b) < 10 * DB
 		.test_case_name = #TEST_CASE_NAME, \
 		.test_name = #TEST_NAME, \
 		.test_body = & TEST_CASE_NAME ## __ ## TEST_NAME, \
+		.benchmark_body = NULL, \
 		.state = 0, \
 		.number_of_tests = 0, \
-		.next = NULL \
 	}; \
-	void __attribute__((constructor)) _register__ ## TEST_CASE_NAME ## __ ## TEST_NAME () { \
-		struct ctester_test_case_list_t *test = & ctester_test_case_info_ ## TEST_CASE_NAME ## __ ## TEST_NAME; \
-		struct ctester_test_case_list_t iter_root = { \
-			.full_test_name = "", .test_case_name = "", .test_name = "", .test_body = NULL, .state = 0, \
-			.number_of_tests = 0, .next = ctester_test_root \
-		}; \
-		struct ctester_test_case_list_t *iter = &iter_root; \
-		while(iter->next && strcmp(iter->next->full_test_name, test->full_test_name) < 0) { \
-			iter = iter->next; \
-		} \
-		if(iter->next) { \
-			test->next = iter->next; \
-		} \
-		iter->next = test; \
-		if(iter == &iter_root) { \
-			ctester_test_root = test; \
+	_CTESTER_REGISTER(ctester_test_case_info_ ## TEST_CASE_NAME ## __ ## TEST_NAME); \
+	void TEST_CASE_NAME ## __ ## TEST_NAME (struct ctester_test_case_state_t *ctester_state) \
+
+/**
+ * Define a benchmark within a test case
+ *
+ * The body following the macro is a single operation. The runner calls it in
+ * a tight loop, calibrates the number of iterations to a target time and
+ * reports statistics on the time per operation. Benchmarks only run if the
+ * binary is invoked with `--bench`, and are selected using `-t` just like
+ * tests. Assertions may be used within the body. The first failing one,
+ * including those of `EXPECT_*` macros, stops the benchmark and fails it.
+ *
+ * Example:
+ * \code{.c}
+ *    #include <ctester.h>
+ *
+ *    BENCHMARK(Factorial, Ten) {
+ *        CTESTER_DO_NOT_OPTIMIZE(Factorial(10));
+ *    }
+ * \endcode
+ */
+#define BENCHMARK(TEST_CASE_NAME, TEST_NAME) \
+	static inline __attribute__((always_inline)) void TEST_CASE_NAME ## __ ## TEST_NAME ## __operation (struct ctester_test_case_state_t *ctester_state); \
+	void TEST_CASE_NAME ## __ ## TEST_NAME (struct ctester_test_case_state_t *ctester_state, unsigned long iterations) { \
+		for(unsigned long i = 0; i < iterations; i++) { \
+			TEST_CASE_NAME ## __ ## TEST_NAME ## __operation(ctester_state); \
+			if(__builtin_expect(ctester_state->failed || ctester_state->warning, 0)) { \
+				/* Stop at the first failure instead of reporting it once per iteration */ \
+				if(!ctester_state->failed) { \
+					ctester_state->failed = __LINE__; \
+				} \
+				return; \
+			} \
 		} \
 	} \
-	void TEST_CASE_NAME ## __ ## TEST_NAME (struct ctester_test_case_state_t *ctester_state) \
+	struct ctester_test_case_list_t ctester_test_case_info_ ## TEST_CASE_NAME ## __ ## TEST_NAME = { \
+		.full_test_name = #TEST_CASE_NAME "." #TEST_NAME, \
+		.test_case_name = #TEST_CASE_NAME, \
+		.test_name = #TEST_NAME, \
+		.test_body = NULL, \
+		.benchmark_body = & TEST_CASE_NAME ## __ ## TEST_NAME, \
+		.state = 0, \
+		.number_of_tests = 0, \
+	}; \
+	_CTESTER_REGISTER(ctester_test_case_info_ ## TEST_CASE_NAME ## __ ## TEST_NAME); \
+	static inline __attribute__((always_inline)) void TEST_CASE_NAME ## __ ## TEST_NAME ## __operation (struct ctester_test_case_state_t *ctester_state __attribute__((unused))) \
+
+/**
+ * \defgroup allocation_macros Allocation assertions
+ * @{
+ *
+ * These require `ctester-alloc.c` to be linked into the test binary.
+ */
+
+/// \internal
+#define _CTESTER_TEST_ALLOCS(statement, max_allocs, CHECK, custom_message, ...) \
+	{ \
+		unsigned long long allocations_before = __atomic_load_n(&ctester_alloc_stats.allocations, __ATOMIC_RELAXED); \
+		statement; \
+		unsigned long long allocations = __atomic_load_n(&ctester_alloc_stats.allocations, __ATOMIC_RELAXED) - allocations_before; \
+		CHECK(<=, allocations, (unsigned long long)(max_allocs), custom_message, ## __VA_ARGS__); \
+	} \
+	_ctester_nop()
+
+/// Assert that the statement allocates at most `max_allocs` blocks on the heap
+#define ASSERT_MAX_ALLOCS(statement, max_allocs, ...) _CTESTER_TEST_ALLOCS(statement, max_allocs, _CTESTER_ASSERT2, "" __VA_ARGS__)
+/// Expect that the statement allocates at most `max_allocs` blocks on the heap
+#define EXPECT_MAX_ALLOCS(statement, max_allocs, ...) _CTESTER_TEST_ALLOCS(statement, max_allocs, _CTESTER_EXPECT2, "" __VA_ARGS__)
+
+/// \internal
+#define _CTESTER_TEST_NO_LEAKS(CHECK, custom_message, ...) \
+	{ \
+		long long leaked_bytes = __atomic_load_n(&ctester_alloc_stats.live_bytes, __ATOMIC_RELAXED); \
+		CHECK(<=, leaked_bytes, 0LL, custom_message, ## __VA_ARGS__); \
+	} \
+	_ctester_nop()
+
+/**
+ * Assert that all memory the test allocated so far has been released
+ *
+ * Within a ::TEST_F, this includes memory allocated by ::SET_UP. Memory that
+ * glibc keeps for the threads a test started is not counted.
+ */
+#define ASSERT_NO_LEAKS(...) _CTESTER_TEST_NO_LEAKS(_CTESTER_ASSERT2, "" __VA_ARGS__)
+/// Expect that all memory the test allocated so far has been released, see ::ASSERT_NO_LEAKS
+#define EXPECT_NO_LEAKS(...) _CTESTER_TEST_NO_LEAKS(_CTESTER_EXPECT2, "" __VA_ARGS__)
 
 /// @}
 
 /**
- * \defgroup flow_control Test flow control
+ * \defgroup bulk_assertions Bulk assertions
  * @{
+ *
+ * These compare whole buffers at once, using SIMD instructions where the CPU
+ * has them. On failure, they report the number of mismatches and show the
+ * values around the first one.
  */
 
-/// Explicitly fail a test
-#define _CTESTER_MSG0(...) _ctester_nop()
-#define _CTESTER_MSGG(...) fprintf(stderr, _CTESTER_INDENT "    Message: " __VA_ARGS__); fprintf(stderr, "\n");
-#define _CTESTER_MSGD(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, NAME, ...) NAME
-#define _CTESTER_MSG(...) _CTESTER_MSGD(_0, ## __VA_ARGS__, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSG0)(__VA_ARGS__)
+#define _CTESTER_VALUE_MEMORY 7
 
-#define FAIL(...) \
-	fprintf(stderr, _CTESTER_INDENT "%s (%s:%d): FAIL() called\n", __func__, __FILE__, __LINE__); \
-	_CTESTER_MSG(__VA_ARGS__); \
-	ctester_state->failed = __LINE__; \
-	return
+#define _CTESTER_COMPARE_BYTES 0
+#define _CTESTER_COMPARE_ABSOLUTE 1
+#define _CTESTER_COMPARE_ULPS 2
 
-/// Explicitly add a warning
-#define ADD_FAILURE(...) \
-	fprintf(stderr, _CTESTER_INDENT "%s (%s:%d): ADD_FAILURE() called\n", __func__, __FILE__, __LINE__); \
-	_CTESTER_MSG(__VA_ARGS__); \
-	ctester_state->warning++; \
-	return
+/**
+ * Two buffers compared by a bulk assertion.
+ *
+ * \internal
+ */
+struct ctester_array_t {
+	const void *a;           //<<< First buffer
+	const void *b;           //<<< Second buffer
+	size_t count;            //<<< Number of elements in each buffer
+	size_t element_size;     //<<< Size of an element in bytes
+	int kind;                //<<< `_CTESTER_VALUE_*` constant for the type of the elements
+	int comparison;          //<<< One of the `_CTESTER_COMPARE_*` constants
+	double tolerance;        //<<< Greatest absolute difference of matching elements, for `_CTESTER_COMPARE_ABSOLUTE`
+	unsigned long long ulps; //<<< Greatest distance in units in the last place of matching elements, for `_CTESTER_COMPARE_ULPS`
+};
+
+/// Map the type of `x` to the `_CTESTER_VALUE_*` constant used to print arrays of it
+#define _CTESTER_VALUE_KIND(x) _Generic((x), \
+	_Bool: _CTESTER_VALUE_UNSIGNED, \
+	unsigned char: _CTESTER_VALUE_UNSIGNED, \
+	unsigned short: _CTESTER_VALUE_UNSIGNED, \
+	unsigned int: _CTESTER_VALUE_UNSIGNED, \
+	unsigned long int: _CTESTER_VALUE_UNSIGNED, \
+	unsigned long long int: _CTESTER_VALUE_UNSIGNED, \
+	char: _CTESTER_VALUE_SIGNED, \
+	signed char: _CTESTER_VALUE_SIGNED, \
+	short: _CTESTER_VALUE_SIGNED, \
+	int: _CTESTER_VALUE_SIGNED, \
+	long int: _CTESTER_VALUE_SIGNED, \
+	long long int: _CTESTER_VALUE_SIGNED, \
+	double: _CTESTER_VALUE_DOUBLE, \
+	long double: _CTESTER_VALUE_LONG_DOUBLE, \
+	float: _CTESTER_VALUE_FLOAT, \
+	default: _CTESTER_VALUE_MEMORY)
+
+/**
+ * Return the index of the first element at or after `start` that differs
+ * between the two buffers, or the number of elements if there is none.
+ */
+size_t _ctester_array_mismatch(const struct ctester_array_t *array, size_t start);
+
+/**
+ * Report two buffers that differ, starting at element `first`, like
+ * ::_ctester_report_comparison.
+ */
+void _ctester_report_array(struct ctester_test_case_state_t *ctester_state, int fatal, const char *file, int line, const char *expression,
+	const char *a, const char *b, const struct ctester_array_t *array, size_t first, int has_message, const char *message_format, ...)
+	__attribute__((cold, noinline, format(printf, 11, 12)));
+
+/// \internal
+#define _CTESTER_TEST_ARRAY(fatal, failure_action, checks, expression, a, b, elements, kind, element_size, comparison, tolerance, ulps, custom_message, ...) \
+	{ \
+		checks; \
+		/* The parentheses keep the commas from splitting the arguments of enclosing macros */ \
+		const struct ctester_array_t ctester_array = ((struct ctester_array_t){ (a), (b), (elements), element_size, kind, comparison, tolerance, ulps }); \
+		size_t ctester_mismatch = _ctester_array_mismatch(&ctester_array, 0); \
+		if(__builtin_expect(ctester_mismatch < ctester_array.count, 0)) { \
+			_ctester_report_array(ctester_state, fatal, __FILE__, __LINE__, expression, #a, #b, &ctester_array, ctester_mismatch, \
+				sizeof(custom_message) > 1, ",\n" _CTESTER_INDENT "    Message: " custom_message, ## __VA_ARGS__); \
+			failure_action; \
+		} \
+	} \
+	_ctester_nop()
+
+/// \internal
+#define _CTESTER_TEST_ARRAY_EQ(fatal, failure_action, a, b, count, custom_message, ...) \
+	_CTESTER_TEST_ARRAY(fatal, failure_action, _Static_assert(sizeof(*(a)) == sizeof(*(b)), "The elements of " #a " and " #b " differ in size"), \
+		#a " == " #b " in " #count " elements", a, b, count, _CTESTER_VALUE_KIND(*(a)), sizeof(*(a)), \
+		_CTESTER_COMPARE_BYTES, 0, 0, custom_message, ## __VA_ARGS__)
+
+/// \internal
+#define _CTESTER_TEST_ARRAY_NEAR(fatal, failure_action, expression, a, b, count, comparison, tolerance, ulps, custom_message, ...) \
+	_CTESTER_TEST_ARRAY(fatal, failure_action, \
+		_Static_assert(_CTESTER_VALUE_KIND(*(a)) == _CTESTER_VALUE_KIND(*(b)) && \
+			(_CTESTER_VALUE_KIND(*(a)) == _CTESTER_VALUE_FLOAT || _CTESTER_VALUE_KIND(*(a)) == _CTESTER_VALUE_DOUBLE), \
+			#a " and " #b " are not both arrays of float or of double"), \
+		expression, a, b, count, _CTESTER_VALUE_KIND(*(a)), sizeof(*(a)), comparison, tolerance, ulps, \
+		custom_message, ## __VA_ARGS__)
+
+/// Assert that the first `size` bytes at `a` and `b` are equal
+#define ASSERT_MEMEQ(a, b, size, ...) \
+	_CTESTER_TEST_ARRAY(1, return, (void)0, "memcmp(" #a ", " #b ", " #size ") == 0", a, b, size, _CTESTER_VALUE_MEMORY, 1, _CTESTER_COMPARE_BYTES, 0, 0, "" __VA_ARGS__)
+/// Expect that the first `size` bytes at `a` and `b` are equal
+#define EXPECT_MEMEQ(a, b, size, ...) \
+	_CTESTER_TEST_ARRAY(0, (void)0, (void)0, "memcmp(" #a ", " #b ", " #size ") == 0", a, b, size, _CTESTER_VALUE_MEMORY, 1, _CTESTER_COMPARE_BYTES, 0, 0, "" __VA_ARGS__)
+
+/**
+ * Assert that the first `count` elements of the arrays `a` and `b` are equal
+ *
+ * Elements are compared by their bytes, so this is meant for arrays of
+ * integers, and of floating point numbers that must match exactly.
+ */
+#define ASSERT_ARRAY_EQ(a, b, count, ...) _CTESTER_TEST_ARRAY_EQ(1, return, a, b, count, "" __VA_ARGS__)
+/// Expect that the first `count` elements of the arrays `a` and `b` are equal, see ::ASSERT_ARRAY_EQ
+#define EXPECT_ARRAY_EQ(a, b, count, ...) _CTESTER_TEST_ARRAY_EQ(0, (void)0, a, b, count, "" __VA_ARGS__)
+
+/**
+ * Assert that the first `count` elements of the float or double arrays `a`
+ * and `b` differ by at most `tolerance`
+ *
+ * A NaN only matches another NaN. For arrays of float, the difference is
+ * computed in single precision.
+ */
+#define ASSERT_ARRAY_NEAR(a, b, count, tolerance, ...) \
+	_CTESTER_TEST_ARRAY_NEAR(1, return, #a " == " #b " within " #tolerance " in " #count " elements", a, b, count, _CTESTER_COMPARE_ABSOLUTE, \
+		tolerance, 0, "" __VA_ARGS__)
+/// Expect that the first `count` elements of `a` and `b` differ by at most `tolerance`, see ::ASSERT_ARRAY_NEAR
+#define EXPECT_ARRAY_NEAR(a, b, count, tolerance, ...) \
+	_CTESTER_TEST_ARRAY_NEAR(0, (void)0, #a " == " #b " within " #tolerance " in " #count " elements", a, b, count, _CTESTER_COMPARE_ABSOLUTE, \
+		tolerance, 0, "" __VA_ARGS__)
+
+/**
+ * Assert that the first `count` elements of the float or double arrays `a`
+ * and `b` are at most `ulps` representable numbers apart
+ *
+ * Zeros of either sign are equal, and a NaN only matches another NaN.
+ */
+#define ASSERT_ARRAY_NEAR_ULPS(a, b, count, ulps, ...) \
+	_CTESTER_TEST_ARRAY_NEAR(1, return, #a " == " #b " within " #ulps " ULPs in " #count " elements", a, b, count, _CTESTER_COMPARE_ULPS, \
+		0, ulps, "" __VA_ARGS__)
+/// Expect that the first `count` elements of `a` and `b` are at most `ulps` representable numbers apart, see ::ASSERT_ARRAY_NEAR_ULPS
+#define EXPECT_ARRAY_NEAR_ULPS(a, b, count, ulps, ...) \
+	_CTESTER_TEST_ARRAY_NEAR(0, (void)0, #a " == " #b " within " #ulps " ULPs in " #count " elements", a, b, count, _CTESTER_COMPARE_ULPS, \
+		0, ulps, "" __VA_ARGS__)
+
+/// @}
+
+/**
+ * \defgroup golden_files Golden file assertions
+ * @{
+ *
+ * These compare a buffer against a reference file, which is mapped into
+ * memory instead of read. Relative paths are resolved against the directory
+ * of the source file of the test. With `--update-golden`, references that do
+ * not match are replaced by the buffer instead, except within
+ * ::EXPECT_NONFATAL_FAILURE and ::EXPECT_FATAL_FAILURE.
+ */
+
+/**
+ * Compare `size` bytes at `buffer` against the golden file at `path`, or
+ * update it, and report a failure if they differ. Returns whether they match.
+ *
+ * \internal
+ */
+int _ctester_golden_matches(struct ctester_test_case_state_t *ctester_state, int fatal, const char *file, int line, const char *buffer_text,
+	const void *buffer, size_t size, const char *path, int has_message, const char *message_format, ...)
+	__attribute__((format(printf, 10, 11)));
+
+/// \internal
+#define _CTESTER_TEST_GOLDEN(fatal, failure_action, buffer, size, path, custom_message, ...) \
+	{ \
+		if(!_ctester_golden_matches(ctester_state, fatal, __FILE__, __LINE__, #buffer, (buffer), (size), (path), \
+				sizeof(custom_message) > 1, ",\n" _CTESTER_INDENT "    Message: " custom_message, ## __VA_ARGS__)) { \
+			failure_action; \
+		} \
+	} \
+	_ctester_nop()
+
+/// Assert that the `size` bytes at `buffer` equal the contents of the golden file at `path`
+#define ASSERT_MATCHES_GOLDEN(buffer, size, path, ...) _CTESTER_TEST_GOLDEN(1, return, buffer, size, path, "" __VA_ARGS__)
+/// Expect that the `size` bytes at `buffer` equal the contents of the golden file at `path`
+#define EXPECT_MATCHES_GOLDEN(buffer, size, path, ...) _CTESTER_TEST_GOLDEN(0, (void)0, buffer, size, path, "" __VA_ARGS__)
+
+/// @}
+
+/**
+ * \defgroup counters Performance counters
+ * @{
+ */
+
+#define _CTESTER_COUNTER_INSTRUCTIONS 0
+#define _CTESTER_COUNTER_CYCLES 1
+#define _CTESTER_COUNTER_CACHE_MISSES 2
+#define _CTESTER_COUNTER_BRANCH_MISSES 3
+#define _CTESTER_COUNTER_TASK_CLOCK 4
+#define _CTESTER_COUNTER_PAGE_FAULTS 5
+#define _CTESTER_COUNTER_CONTEXT_SWITCHES 6
+#define _CTESTER_NUMBER_OF_COUNTERS 7
+
+/**
+ * Read a performance counter, counting from the start of the current test.
+ *
+ * \internal
+ */
+unsigned long long _ctester_counter(int counter);
+
+/**
+ * Read a performance counter within a test, counting from the start of the
+ * test, e.g. `EXPECT_LE(ctester_counter(INSTRUCTIONS), 5000000)`.
+ *
+ * `NAME` is one of `INSTRUCTIONS`, `CYCLES`, `CACHE_MISSES`, `BRANCH_MISSES`,
+ * `TASK_CLOCK` (in nanoseconds), `PAGE_FAULTS` or `CONTEXT_SWITCHES`. The
+ * counter must be enabled with `--counters`, otherwise, or if the system does
+ * not provide it, this returns 0.
+ */
+#define ctester_counter(NAME) _ctester_counter(_CTESTER_COUNTER_ ## NAME)
+
+/// @}
+
+/**
+ * \defgroup performance_macros Performance assertions
+ * @{
+ */
+
+/// Number of batches ::ASSERT_FASTER_THAN and ::ASSERT_COMPLEXITY time
+#define _CTESTER_TIMING_SAMPLES 15
+/// Minimal duration of a batch in nanoseconds, such that the clock's resolution does not matter
+#define _CTESTER_TIMING_MIN_BATCH_NS 20000ULL
+
+#define O_1 0         //<<< Constant complexity for ::ASSERT_COMPLEXITY
+#define O_LOG_N 1     //<<< Logarithmic complexity for ::ASSERT_COMPLEXITY
+#define O_N 2         //<<< Linear complexity for ::ASSERT_COMPLEXITY
+#define O_N_LOG_N 3   //<<< Linearithmic complexity for ::ASSERT_COMPLEXITY
+#define O_N_SQUARED 4 //<<< Quadratic complexity for ::ASSERT_COMPLEXITY
+
+/**
+ * State of the timing loop of ::_CTESTER_TEST_FASTER_THAN.
+ *
+ * \internal
+ */
+struct ctester_timing_t {
+	unsigned long iterations;   //<<< Number of repetitions of the statement per batch
+	int number_of_samples;      //<<< Number of batches timed so far
+	unsigned long long start;   //<<< Start time of the current batch
+	double samples[_CTESTER_TIMING_SAMPLES]; //<<< Time per repetition in each batch, in nanoseconds
+	double median;              //<<< Median of ::samples, set once the loop ends
+};
+
+/**
+ * Step the timing loop of ::_CTESTER_TEST_FASTER_THAN: Account for the batch
+ * that just ended, if any, and return whether another batch of
+ * `timing->iterations` repetitions should run.
+ *
+ * The first batches calibrate the number of repetitions per batch.
+ *
+ * \internal
+ */
+int _ctester_timing_next(struct ctester_timing_t *timing);
+
+/**
+ * Time `function` for each of the `count` input sizes in `sizes`, and check
+ * that the complexity model fitting the timings best is at most `complexity`.
+ * Prints the start of a failure message to `output` and returns 0 if it
+ * isn't.
+ *
+ * \internal
+ */
+int _ctester_check_complexity(void (*function)(size_t n), const size_t *sizes, size_t count, int complexity, const char *function_name, const char *file, int line, FILE *output);
+
+/// \internal
+#define _CTESTER_TEST_FASTER_THAN(statement, max_ns, CHECK, custom_message, ...) \
+	{ \
+		struct ctester_timing_t timing = { 0 }; \
+		while(_ctester_timing_next(&timing)) { \
+			for(unsigned long _ctester_i = 0; _ctester_i < timing.iterations; _ctester_i++) { \
+				statement; \
+			} \
+		} \
+		unsigned long long median_ns = timing.median; \
+		CHECK(<=, median_ns, (unsigned long long)(max_ns), custom_message, ## __VA_ARGS__); \
+	} \
+	_ctester_nop()
+
+/**
+ * Assert that the statement takes at most `max_ns` nanoseconds
+ *
+ * The statement is repeated in batches, and the median time per repetition
+ * is compared against the budget. This is robust against outliers, e.g. from
+ * interrupts, but budgets should still leave room for slower machines.
+ */
+#define ASSERT_FASTER_THAN(statement, max_ns, ...) _CTESTER_TEST_FASTER_THAN(statement, max_ns, _CTESTER_ASSERT2, "" __VA_ARGS__)
+/// Expect that the statement takes at most `max_ns` nanoseconds, see ::ASSERT_FASTER_THAN
+#define EXPECT_FASTER_THAN(statement, max_ns, ...) _CTESTER_TEST_FASTER_THAN(statement, max_ns, _CTESTER_EXPECT2, "" __VA_ARGS__)
+
+/// \internal
+#define _CTESTER_TEST_COMPLEXITY(function, sizes, complexity, on_failure, custom_message, ...) \
+	{ \
+		_Static_assert(!__builtin_types_compatible_p(__typeof__(sizes), __typeof__(&(sizes)[0])), #sizes " must be an array, not a pointer"); \
+		if(!_ctester_check_complexity(function, sizes, sizeof(sizes) / sizeof(*(sizes)), complexity, #function, __FILE__, __LINE__, _CTESTER_OUTPUT)) { \
+			if(*custom_message) { \
+				fprintf(_CTESTER_OUTPUT, ",\n" _CTESTER_INDENT "    Message: " custom_message, ## __VA_ARGS__); \
+			} \
+			fprintf(_CTESTER_OUTPUT, "\n"); \
+			on_failure; \
+		} \
+	} \
+	_ctester_nop()
+
+/**
+ * Assert that `function` runs in at most the given complexity
+ *
+ * `function` takes the input size as its only argument, and is timed for
+ * each size in the array `sizes`, which must not decay to a pointer, as its
+ * length is taken from its type. The timings are fitted against the
+ * ::O_1, ::O_LOG_N, ::O_N, ::O_N_LOG_N and ::O_N_SQUARED models by least
+ * squares, and the assertion fails if the best fit is worse than
+ * `complexity`.
+ *
+ * Sizes should span at least two orders of magnitude, and the largest should
+ * take a while, such that the models are told apart.
+ *
+ * Example:
+ * \code{.c}
+ *    #include <ctester.h>
+ *
+ *    static void sort_random(size_t n) {
+ *        ...
+ *    }
+ *
+ *    TEST(Sort, Complexity) {
+ *        size_t sizes[] = { 1000, 4000, 16000, 64000, 256000 };
+ *        ASSERT_COMPLEXITY(sort_random, sizes, O_N_LOG_N);
+ *    }
+ * \endcode
+ */
+#define ASSERT_COMPLEXITY(function, sizes, complexity, ...) _CTESTER_TEST_COMPLEXITY(function, sizes, complexity, _ctester_fatal_failure(ctester_state, __LINE__); return, "" __VA_ARGS__)
+/// Expect that `function` runs in at most the given complexity, see ::ASSERT_COMPLEXITY
+#define EXPECT_COMPLEXITY(function, sizes, complexity, ...) _CTESTER_TEST_COMPLEXITY(function, sizes, complexity, _CTESTER_NONFATAL_FAILURE(), "" __VA_ARGS__)
+
+/// @}
+
+/**
+ * Declare the fixture of a test case for use with ::TEST_F
+ *
+ * The macro is followed by the body of a struct, which holds the state each
+ * test of the case starts with. Tests access it through the `fixture` pointer.
+ * The optional ::SET_UP and ::TEAR_DOWN functions prepare and release it for
+ * each test, and the optional ::SET_UP_TEST_CASE and ::TEAR_DOWN_TEST_CASE
+ * functions run once around all tests of the case, for expensive state that
+ * tests share, e.g. in static variables.
+ *
+ * Example:
+ * \code{.c}
+ *    #include <ctester.h>
+ *
+ *    static struct index *shared_index;
+ *
+ *    FIXTURE(IndexTest) {
+ *        struct cursor *cursor;
+ *    };
+ *
+ *    SET_UP_TEST_CASE(IndexTest) {
+ *        shared_index = build_index();
+ *        ASSERT_NE(shared_index, NULL);
+ *    }
+ *
+ *    TEAR_DOWN_TEST_CASE(IndexTest) {
+ *        free_index(shared_index);
+ *    }
+ *
+ *    SET_UP(IndexTest) {
+ *        fixture->cursor = open_cursor(shared_index);
+ *    }
+ *
+ *    TEAR_DOWN(IndexTest) {
+ *        close_cursor(fixture->cursor);
+ *    }
+ *
+ *    TEST_F(IndexTest, FindsFirstKey) {
+ *        ASSERT_EQ(cursor_key(fixture->cursor), 1);
+ *    }
+ * \endcode
+ */
+#define FIXTURE(TEST_CASE_NAME) \
+	struct ctester_fixture_ ## TEST_CASE_NAME; \
+	void TEST_CASE_NAME ## __set_up(struct ctester_test_case_state_t *ctester_state, struct ctester_fixture_ ## TEST_CASE_NAME *fixture) __attribute__((weak)); \
+	void TEST_CASE_NAME ## __tear_down(struct ctester_test_case_state_t *ctester_state, struct ctester_fixture_ ## TEST_CASE_NAME *fixture) __attribute__((weak)); \
+	void TEST_CASE_NAME ## __set_up_test_case(struct ctester_test_case_state_t *ctester_state) __attribute__((weak)); \
+	void TEST_CASE_NAME ## __tear_down_test_case(struct ctester_test_case_state_t *ctester_state) __attribute__((weak)); \
+	struct ctester_fixture_ ## TEST_CASE_NAME
+
+/**
+ * Define the function preparing the ::FIXTURE for each test of a case
+ *
+ * The fixture is zero-initialized before. Assertions may be used; if one
+ * fails, the test is not run, but ::TEAR_DOWN still is.
+ */
+#define SET_UP(TEST_CASE_NAME) \
+	void TEST_CASE_NAME ## __set_up(struct ctester_test_case_state_t *ctester_state __attribute__((unused)), struct ctester_fixture_ ## TEST_CASE_NAME *fixture __attribute__((unused)))
+
+/**
+ * Define the function releasing the ::FIXTURE after each test of a case
+ */
+#define TEAR_DOWN(TEST_CASE_NAME) \
+	void TEST_CASE_NAME ## __tear_down(struct ctester_test_case_state_t *ctester_state __attribute__((unused)), struct ctester_fixture_ ## TEST_CASE_NAME *fixture __attribute__((unused)))
+
+/**
+ * Define the function run once before the tests of a case with a ::FIXTURE
+ *
+ * The runner calls it when it enters the test case. If an assertion fails
+ * in it, all tests of the case fail. Tests running with `--isolate` share the
+ * state it sets up, while each worker of `-j` runs it itself, once before the
+ * first test of the case it gets.
+ */
+#define SET_UP_TEST_CASE(TEST_CASE_NAME) \
+	void TEST_CASE_NAME ## __set_up_test_case(struct ctester_test_case_state_t *ctester_state __attribute__((unused)))
+
+/**
+ * Define the function run once after the tests of a case with a ::FIXTURE
+ */
+#define TEAR_DOWN_TEST_CASE(TEST_CASE_NAME) \
+	void TEST_CASE_NAME ## __tear_down_test_case(struct ctester_test_case_state_t *ctester_state __attribute__((unused)))
+
+/**
+ * Define a test using the ::FIXTURE of its test case
+ *
+ * Like ::TEST, but the body has access to a fresh instance of the fixture
+ * through the `fixture` pointer, prepared by ::SET_UP and released by
+ * ::TEAR_DOWN.
+ */
+#define TEST_F(TEST_CASE_NAME, TEST_NAME) \
+	void TEST_CASE_NAME ## __ ## TEST_NAME ## __body (struct ctester_test_case_state_t *ctester_state, struct ctester_fixture_ ## TEST_CASE_NAME *fixture); \
+	void TEST_CASE_NAME ## __ ## TEST_NAME (struct ctester_test_case_state_t *ctester_state) { \
+		struct ctester_fixture_ ## TEST_CASE_NAME fixture; \
+		memset(&fixture, 0, sizeof(fixture)); \
+		/* The hooks are weak, and NULL unless defined */ \
+		__typeof__(&TEST_CASE_NAME ## __set_up) set_up = TEST_CASE_NAME ## __set_up; \
+		__typeof__(&TEST_CASE_NAME ## __tear_down) tear_down = TEST_CASE_NAME ## __tear_down; \
+		if(set_up) { \
+			set_up(ctester_state, &fixture); \
+		} \
+		if(!ctester_state->failed) { \
+			TEST_CASE_NAME ## __ ## TEST_NAME ## __body(ctester_state, &fixture); \
+		} \
+		if(tear_down) { \
+			int failed = ctester_state->failed; \
+			ctester_state->failed = 0; \
+			tear_down(ctester_state, &fixture); \
+			if(failed) { \
+				ctester_state->failed = failed; \
+			} \
+		} \
+	} \
+	struct ctester_test_case_list_t ctester_test_case_info_ ## TEST_CASE_NAME ## __ ## TEST_NAME = { \
+		.full_test_name = #TEST_CASE_NAME "." #TEST_NAME, \
+		.test_case_name = #TEST_CASE_NAME, \
+		.test_name = #TEST_NAME, \
+		.test_body = & TEST_CASE_NAME ## __ ## TEST_NAME, \
+		.benchmark_body = NULL, \
+		.state = 0, \
+		.number_of_tests = 0, \
+		.set_up_test_case = TEST_CASE_NAME ## __set_up_test_case, \
+		.tear_down_test_case = TEST_CASE_NAME ## __tear_down_test_case, \
+	}; \
+	_CTESTER_REGISTER(ctester_test_case_info_ ## TEST_CASE_NAME ## __ ## TEST_NAME); \
+	void TEST_CASE_NAME ## __ ## TEST_NAME ## __body (struct ctester_test_case_state_t *ctester_state, struct ctester_fixture_ ## TEST_CASE_NAME *fixture __attribute__((unused))) \
+
+/**
+ * Define a value-parameterized test within a test case
+ *
+ * Like ::TEST, but the test runs once for each parameter generated by the
+ * ::INSTANTIATE_TEST_CASE_P instantiations of its test case. Each run is a
+ * test of its own, named `prefix/test_case.test/index`, such that parameters
+ * can be selected with `-t` and run in parallel. The body reads its
+ * parameters with ::PARAM_INT and ::PARAM_VALUE.
+ *
+ * Example:
+ * \code{.c}
+ *    #include <ctester.h>
+ *
+ *    TEST_P(Sort, IsSorted) {
+ *        long long size = PARAM_INT(0);
+ *        const char *order = PARAM_VALUE(const char *, 1);
+ *        ASSERT_TRUE(is_sorted(sort(make_input(size, order)), size));
+ *    }
+ *
+ *    INSTANTIATE_TEST_CASE_P(Sizes, Sort, CTESTER_COMBINE(
+ *        CTESTER_RANGE(0, 10000, 1),
+ *        CTESTER_VALUES(const char *, "ascending", "descending", "random")));
+ * \endcode
+ */
+#define TEST_P(TEST_CASE_NAME, TEST_NAME) \
+	void TEST_CASE_NAME ## __ ## TEST_NAME (struct ctester_test_case_state_t *ctester_state, const union ctester_param_t *ctester_params); \
+	struct ctester_test_case_list_t ctester_test_case_info_ ## TEST_CASE_NAME ## __ ## TEST_NAME = { \
+		.full_test_name = #TEST_CASE_NAME "." #TEST_NAME, \
+		.test_case_name = #TEST_CASE_NAME, \
+		.test_name = #TEST_NAME, \
+		.test_body = NULL, \
+		.benchmark_body = NULL, \
+		.state = 0, \
+		.number_of_tests = 0, \
+		.param_body = & TEST_CASE_NAME ## __ ## TEST_NAME, \
+	}; \
+	_CTESTER_REGISTER(ctester_test_case_info_ ## TEST_CASE_NAME ## __ ## TEST_NAME); \
+	void TEST_CASE_NAME ## __ ## TEST_NAME (struct ctester_test_case_state_t *ctester_state, const union ctester_param_t *ctester_params __attribute__((unused))) \
+
+/**
+ * Run the ::TEST_P tests of a test case for each parameter of a generator
+ *
+ * The generator is one of ::CTESTER_RANGE, ::CTESTER_VALUES and
+ * ::CTESTER_COMBINE. A test case may be instantiated several times, with
+ * different prefixes.
+ */
+#define INSTANTIATE_TEST_CASE_P(PREFIX, TEST_CASE_NAME, GENERATOR) \
+	static const struct ctester_instantiation_t ctester_instantiation_ ## PREFIX ## __ ## TEST_CASE_NAME = { \
+		.prefix = #PREFIX, \
+		.test_case_name = #TEST_CASE_NAME, \
+		.generator = GENERATOR, \
+	}; \
+	static const struct ctester_instantiation_t *_ctester_registration_ ## PREFIX ## __ ## TEST_CASE_NAME __attribute__((used, section("ctester_instantiations"))) = & ctester_instantiation_ ## PREFIX ## __ ## TEST_CASE_NAME
+
+/**
+ * Generate the integers from `range_start` up to, but excluding, `range_end`
+ * in steps of `range_step`, for ::INSTANTIATE_TEST_CASE_P. Read them with ::PARAM_INT.
+ */
+#define CTESTER_RANGE(range_start, range_end, range_step) \
+	(&(const struct ctester_generator_t){ .kind = _CTESTER_GENERATOR_RANGE, .start = (range_start), .end = (range_end), .step = (range_step) })
+
+/**
+ * Generate the given values of type `type`, for ::INSTANTIATE_TEST_CASE_P.
+ * Read them with ::PARAM_VALUE.
+ */
+#define CTESTER_VALUES(type, ...) \
+	(&(const struct ctester_generator_t){ .kind = _CTESTER_GENERATOR_VALUES, .values = (const type[]){ __VA_ARGS__ }, \
+		.value_size = sizeof(type), .count = sizeof((const type[]){ __VA_ARGS__ }) / sizeof(type) })
+
+/**
+ * Generate all combinations of the parameters of the given generators, for
+ * ::INSTANTIATE_TEST_CASE_P. Each generator contributes its parameters in
+ * order, such that the first one is read with index 0, and so on.
+ */
+#define CTESTER_COMBINE(...) \
+	(&(const struct ctester_generator_t){ .kind = _CTESTER_GENERATOR_COMBINE, .factors = (const struct ctester_generator_t *const[]){ __VA_ARGS__ }, \
+		.count = sizeof((const struct ctester_generator_t *const[]){ __VA_ARGS__ }) / sizeof(const struct ctester_generator_t *) })
+
+/// Read parameter `index` of a ::TEST_P, generated by ::CTESTER_RANGE
+#define PARAM_INT(index) (ctester_params[index].integer)
+/// Read parameter `index` of a ::TEST_P, generated by ::CTESTER_VALUES with type `type`
+#define PARAM_VALUE(type, index) (*(const type *)ctester_params[index].value)
+
+/**
+ * Run a property against random inputs, and shrink the first one it fails
+ * for.
+ *
+ * \internal
+ */
+void _ctester_run_property(struct ctester_test_case_state_t *ctester_state, const struct ctester_property_t *property);
+
+/**
+ * Define a property-based test within a test case
+ *
+ * The body runs against random inputs from the given generators, see
+ * ::CTESTER_ANY_INT and friends, and reads them with ::PROPERTY_INT and
+ * friends. Inputs are generated until the body reports a failure, up to
+ * `--property-runs` times or for `--property-time-ms`. The failing input is
+ * then shrunk to a minimal one, which is printed along with the seed to
+ * reproduce it, and the body runs once more against it to report its
+ * failures. Any failure of the body fails the test.
+ *
+ * Example:
+ * \code{.c}
+ *    #include <ctester.h>
+ *
+ *    PROPERTY(Sort, IsSorted, CTESTER_ANY_ARRAY(CTESTER_ANY_INT(-1000, 1000), 0, 100)) {
+ *        size_t size = PROPERTY_SIZE(0);
+ *        long long values[size + 1];
+ *        memcpy(values, PROPERTY_DATA(long long, 0), size * sizeof(long long));
+ *        sort(values, size);
+ *        for(size_t i = 1; i < size; i++) {
+ *            EXPECT_LE(values[i - 1], values[i]);
+ *        }
+ *    }
+ * \endcode
+ */
+#define PROPERTY(TEST_CASE_NAME, TEST_NAME, ...) \
+	void TEST_CASE_NAME ## __ ## TEST_NAME ## __property (struct ctester_test_case_state_t *ctester_state, const struct ctester_property_value_t *ctester_property); \
+	static const struct ctester_property_t ctester_property_info_ ## TEST_CASE_NAME ## __ ## TEST_NAME = { \
+		.body = & TEST_CASE_NAME ## __ ## TEST_NAME ## __property, \
+		.arbitraries = (const struct ctester_arbitrary_t *const[]){ __VA_ARGS__ }, \
+		.count = sizeof((const struct ctester_arbitrary_t *const[]){ __VA_ARGS__ }) / sizeof(const struct ctester_arbitrary_t *), \
+		.file = __FILE__, \
+		.line = __LINE__, \
+	}; \
+	TEST(TEST_CASE_NAME, TEST_NAME) { \
+		_ctester_run_property(ctester_state, & ctester_property_info_ ## TEST_CASE_NAME ## __ ## TEST_NAME); \
+	} \
+	void TEST_CASE_NAME ## __ ## TEST_NAME ## __property (struct ctester_test_case_state_t *ctester_state, const struct ctester_property_value_t *ctester_property __attribute__((unused)))
+
+/**
+ * Generate integers from `range_min` to `range_max`, inclusive, for a
+ * ::PROPERTY. Read them with ::PROPERTY_INT. Shrinks towards zero.
+ */
+#define CTESTER_ANY_INT(range_min, range_max) \
+	(&(const struct ctester_arbitrary_t){ .kind = _CTESTER_ARBITRARY_INT, .min = (range_min), .max = (range_max) })
+
+/**
+ * Generate finite doubles from `range_min` to `range_max` for a ::PROPERTY.
+ * Read them with ::PROPERTY_DOUBLE. Shrinks towards zero.
+ */
+#define CTESTER_ANY_DOUBLE(range_min, range_max) \
+	(&(const struct ctester_arbitrary_t){ .kind = _CTESTER_ARBITRARY_DOUBLE, .min_double = (range_min), .max_double = (range_max) })
+
+/**
+ * Generate buffers of `size_min` to `size_max` random bytes for a
+ * ::PROPERTY. Read them with ::PROPERTY_DATA and ::PROPERTY_SIZE. Shrinks
+ * towards fewer zero bytes.
+ */
+#define CTESTER_ANY_BYTES(size_min, size_max) \
+	(&(const struct ctester_arbitrary_t){ .kind = _CTESTER_ARBITRARY_BYTES, .min_size = (size_min), .max_size = (size_max) })
+
+/**
+ * Generate NUL-terminated strings of `length_min` to `length_max` printable
+ * ASCII characters, tabs and newlines, for a ::PROPERTY. Read them with
+ * ::PROPERTY_DATA and ::PROPERTY_SIZE. Shrinks towards fewer `a`s.
+ */
+#define CTESTER_ANY_STRING(length_min, length_max) \
+	(&(const struct ctester_arbitrary_t){ .kind = _CTESTER_ARBITRARY_STRING, .min_size = (length_min), .max_size = (length_max) })
+
+/**
+ * Generate arrays of `size_min` to `size_max` elements from the generator
+ * `element` for a ::PROPERTY. Read them with ::PROPERTY_DATA and
+ * ::PROPERTY_SIZE: Elements from ::CTESTER_ANY_INT and ::CTESTER_ANY_DOUBLE
+ * are stored as `long long` and `double`, others as
+ * ::ctester_property_value_t.
+ */
+#define CTESTER_ANY_ARRAY(element_arbitrary, size_min, size_max) \
+	(&(const struct ctester_arbitrary_t){ .kind = _CTESTER_ARBITRARY_ARRAY, .element = (element_arbitrary), .min_size = (size_min), .max_size = (size_max) })
+
+/// Read input `index` of a ::PROPERTY, generated by ::CTESTER_ANY_INT
+#define PROPERTY_INT(index) (ctester_property[index].integer)
+/// Read input `index` of a ::PROPERTY, generated by ::CTESTER_ANY_DOUBLE
+#define PROPERTY_DOUBLE(index) (ctester_property[index].real)
+/// Read the contents of input `index` of a ::PROPERTY as an array of `type`
+#define PROPERTY_DATA(type, index) ((const type *)ctester_property[index].data)
+/// Read the number of bytes, characters or elements of input `index` of a ::PROPERTY
+#define PROPERTY_SIZE(index) (ctester_property[index].size)
+
+/**
+ * Run the body of a ::TEST_THREADS on increasing numbers of threads and
+ * report how its throughput scales.
+ *
+ * \internal
+ */
+void _ctester_run_threads(struct ctester_test_case_state_t *ctester_state, const struct ctester_threads_t *threads);
+
+/**
+ * Define a concurrency test within a test case
+ *
+ * The body following the macro is a single operation, which runs in a loop on
+ * each of `NUMBER_OF_THREADS` threads at once, or one per online CPU if it is
+ * 0. The threads are pinned to distinct CPUs where possible, and start
+ * together. This is repeated for 1, 2, 4, ... threads up to
+ * `NUMBER_OF_THREADS`, each for `--threads-time-ms`, and the throughput per
+ * thread and its scaling are printed after each round.
+ *
+ * Within the body, ::CTESTER_THREAD is the index of the thread and
+ * ::CTESTER_NUMBER_OF_THREADS the number of threads in the current round.
+ * Each thread has a state of its own, and stops at its first failure, which
+ * is reported along with the thread's index and fails the test.
+ *
+ * Example:
+ * \code{.c}
+ *    #include <ctester.h>
+ *
+ *    TEST_THREADS(Queue, PushPop, 8) {
+ *        ASSERT_TRUE(queue_push(&queue, CTESTER_THREAD));
+ *        ASSERT_TRUE(queue_pop(&queue, NULL));
+ *    }
+ * \endcode
+ */
+#define TEST_THREADS(TEST_CASE_NAME, TEST_NAME, NUMBER_OF_THREADS) \
+	static inline __attribute__((always_inline)) void TEST_CASE_NAME ## __ ## TEST_NAME ## __operation (struct ctester_test_case_state_t *ctester_state, int ctester_thread, int ctester_number_of_threads); \
+	static void TEST_CASE_NAME ## __ ## TEST_NAME ## __loop (struct ctester_test_case_state_t *ctester_state, int ctester_thread, int ctester_number_of_threads, const int *stop, unsigned long long *operations) { \
+		unsigned long long count = 0; \
+		while(!__atomic_load_n(stop, __ATOMIC_RELAXED) && !ctester_state->failed && !ctester_state->warning) { \
+			TEST_CASE_NAME ## __ ## TEST_NAME ## __operation(ctester_state, ctester_thread, ctester_number_of_threads); \
+			count++; \
+		} \
+		*operations = count; \
+	} \
+	static const struct ctester_threads_t ctester_threads_info_ ## TEST_CASE_NAME ## __ ## TEST_NAME = { \
+		.loop = & TEST_CASE_NAME ## __ ## TEST_NAME ## __loop, \
+		.number_of_threads = (NUMBER_OF_THREADS), \
+		.full_test_name = #TEST_CASE_NAME "." #TEST_NAME, \
+	}; \
+	TEST(TEST_CASE_NAME, TEST_NAME) { \
+		_ctester_run_threads(ctester_state, & ctester_threads_info_ ## TEST_CASE_NAME ## __ ## TEST_NAME); \
+	} \
+	static inline __attribute__((always_inline)) void TEST_CASE_NAME ## __ ## TEST_NAME ## __operation (struct ctester_test_case_state_t *ctester_state, int ctester_thread __attribute__((unused)), int ctester_number_of_threads __attribute__((unused)))
+
+/// Index of the thread running the body of a ::TEST_THREADS, counting from 0
+#define CTESTER_THREAD (ctester_thread)
+/// Number of threads running the body of a ::TEST_THREADS in the current round
+#define CTESTER_NUMBER_OF_THREADS (ctester_number_of_threads)
+
+/**
+ * Keep the compiler from optimizing away the computation of `value`, e.g.
+ * within a ::BENCHMARK whose result is otherwise unused.
+ */
+#define CTESTER_DO_NOT_OPTIMIZE(value) \
+	{ \
+		__typeof__(value) _ctester_value = value; \
+		__asm__ volatile("" : : "g"(_ctester_value) : "memory"); \
+	} \
+	_ctester_nop()
+
+/// @}
+
+/**
+ * \defgroup flow_control Test flow control
+ * @{
+ */
+
+/// Explicitly fail a test
+#define _CTESTER_MSG0(...) _ctester_nop()
+#define _CTESTER_MSGG(...) fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "    Message: " __VA_ARGS__); fprintf(_CTESTER_OUTPUT, "\n");
+#define _CTESTER_MSGD(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, NAME, ...) NAME
+#define _CTESTER_MSG(...) _CTESTER_MSGD(_0, ## __VA_ARGS__, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSGG, _CTESTER_MSG0)(__VA_ARGS__)
+
+#define FAIL(...) \
+	fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "%s (%s:%d): FAIL() called\n", __func__, __FILE__, __LINE__); \
+	_CTESTER_MSG(__VA_ARGS__); \
+	_ctester_fatal_failure(ctester_state, __LINE__); \
+	return
+
+/// Explicitly add a warning
+#define ADD_FAILURE(...) \
+	fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "%s (%s:%d): ADD_FAILURE() called\n", __func__, __FILE__, __LINE__); \
+	_CTESTER_MSG(__VA_ARGS__); \
+	_CTESTER_NONFATAL_FAILURE(); \
+	if(ctester_state->fatal_jump) { \
+		longjmp(*ctester_state->fatal_jump, 1); \
+	} \
+	return
+
+/// @}
+
+/**
+ * \defgroup meta_assertions Assertions on assertions
+ * @{
+ *
+ * These check that a statement, e.g. a custom assertion helper, reports
+ * failures. The statement runs against a scratch test state, so its failures
+ * do not count against the current test, and their messages are only printed
+ * if the check fails. Helpers taking the state as an argument must be passed
+ * `ctester_state`.
+ */
+
+/**
+ * Scratch state of a meta-assertion.
+ *
+ * \internal
+ */
+struct ctester_meta_assertion_t {
+	struct ctester_test_case_state_t state; //<<< State the statement runs against
+	jmp_buf fatal_jump;                     //<<< Where a fatal failure of the statement returns to
+	char *output;                           //<<< Failure messages of the statement
+	size_t output_size;                     //<<< Size of ::output
+};
+
+/**
+ * Prepare the scratch state of a meta-assertion.
+ *
+ * \internal
+ */
+void _ctester_meta_begin(struct ctester_meta_assertion_t *meta);
+
+/**
+ * Check the failures the statement of a meta-assertion reported: A fatal
+ * failure if `fatal` is set, or exactly `expected_failures` nonfatal ones
+ * otherwise. If they do not match, the start of a failure message and the
+ * messages of the statement are printed to `output`, and 0 is returned.
+ *
+ * \internal
+ */
+int _ctester_meta_end(struct ctester_meta_assertion_t *meta, int fatal, int expected_failures, const char *statement, const char *file, int line, FILE *output);
+
+/// \internal
+#define _CTESTER_TEST_META(statement, statement_text, fatal, expected_failures, custom_message, ...) \
+	{ \
+		struct ctester_meta_assertion_t meta; \
+		_ctester_meta_begin(&meta); \
+		if(!setjmp(meta.fatal_jump)) { \
+			struct ctester_test_case_state_t *ctester_state = &meta.state; \
+			statement; \
+		} \
+		if(!_ctester_meta_end(&meta, fatal, expected_failures, statement_text, __FILE__, __LINE__, _CTESTER_OUTPUT)) { \
+			if(*custom_message) { \
+				fprintf(_CTESTER_OUTPUT, _CTESTER_INDENT "    Message: " custom_message "\n", ## __VA_ARGS__); \
+			} \
+			_CTESTER_NONFATAL_FAILURE(); \
+		} \
+	} \
+	_ctester_nop()
+
+/**
+ * Expect that the statement reports exactly `count` nonfatal failures, e.g.
+ * from `EXPECT_*` assertions, and no fatal one
+ *
+ * Example:
+ * \code{.c}
+ *    EXPECT_NONFATAL_FAILURE(EXPECT_EQ(1, 2), 1);
+ * \endcode
+ */
+#define EXPECT_NONFATAL_FAILURE(statement, count, ...) _CTESTER_TEST_META(statement, #statement, 0, count, "" __VA_ARGS__)
+
+/**
+ * Expect that the statement reports a fatal failure, e.g. from an `ASSERT_*`
+ * assertion
+ *
+ * The fatal failure ends the statement, but not the current test.
+ */
+#define EXPECT_FATAL_FAILURE(statement, ...) _CTESTER_TEST_META(statement, #statement, 1, 0, "" __VA_ARGS__)
 
 /// @}